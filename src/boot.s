@@ -145,7 +145,14 @@ ExtInt:
         rte
 		
 HBlank:
+        move    #0x2700,sr              /* No vblank while the z80 bus is held */
+        movem.l d0-d1/a0-a1,-(sp)
+        jsr     hblank_handler
+        movem.l (sp)+,d0-d1/a0-a1
         rte
 
 VBlank:
+        movem.l d0-d1/a0-a1,-(sp)       /* Registers C code may clobber */
+        jsr     vblank_handler
+        movem.l (sp)+,d0-d1/a0-a1
         rte
@@ -3,6 +3,6 @@
  * 
  * @param err Error message to display, newlines (\n) are supported
  */
-#define error_fatal(err) _error_other(err, __FILE__, __LINE__)
+#define error_fatal(err) _error_fatal(err, __FILE__, __LINE__)
 
 void _error_fatal(const char *err, const char *file, const uint16_t line);
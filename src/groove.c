@@ -0,0 +1,24 @@
+#include "groove.h"
+
+// the mpc style swings delay every second sixteenth, 48 ticks make a pair of
+// them so 58% puts the late one 0.58 * 48 - 24 = 4 ticks behind the grid
+static const uint8_t grooves[GROOVE_COUNT][GROOVE_STEPS] = {
+  {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, // straight
+  {0, 2, 0, 2, 0, 2, 0, 2, 0, 2, 0, 2, 0, 2, 0, 2}, // 54%
+  {0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4}, // 58%
+  {0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6}, // 62%
+  {0, 8, 0, 8, 0, 8, 0, 8, 0, 8, 0, 8, 0, 8, 0, 8}, // 66%, triplets
+  {0, 3, 1, 5, 0, 2, 2, 6, 0, 4, 1, 3, 0, 2, 3, 7}  // loose, drags into the end of each beat
+};
+
+static const char *const grooveNames[GROOVE_COUNT] = {
+  "none ", "54%  ", "58%  ", "62%  ", "66%  ", "loose"
+};
+
+uint8_t groove_offset(uint8_t groove, uint8_t step) {
+  return grooves[groove < GROOVE_COUNT ? groove : 0][step & (GROOVE_STEPS - 1)];
+}
+
+const char *groove_name(uint8_t groove) {
+  return grooveNames[groove < GROOVE_COUNT ? groove : 0];
+}
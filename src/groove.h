@@ -0,0 +1,14 @@
+#ifndef H_GROOVE
+#define H_GROOVE
+
+#include <stdint.h>
+
+// groove templates: how late each step of a bar plays, in sequencer clock
+// ticks of which a step has 24. steps past the template repeat it
+#define GROOVE_STEPS 16
+#define GROOVE_COUNT 6 // entry 0 is straight
+
+uint8_t groove_offset(uint8_t groove, uint8_t step);
+const char *groove_name(uint8_t groove);
+
+#endif
@@ -0,0 +1,60 @@
+#include "macro.h"
+
+// arpeggios, loop forever
+static const int8_t arpMajor[] = {3, 0, 0, 4, 7};
+static const int8_t arpMinor[] = {3, 0, 0, 3, 7};
+static const int8_t arpOctave[] = {2, 0, 0, 12};
+static const int8_t arpPower[] = {3, 0, 0, 7, 12};
+static const int8_t arpDim[] = {3, 0, 0, 3, 6};
+
+// pitch deltas. wobble loops back to 0 so the note stays in tune, rise and
+// fall keep bending until the sum hits YM_MACRO_BEND_MAX
+static const int8_t pitchWobble[] = {8, 0, 2, 2, -2, -2, -2, -2, 2, 2};
+static const int8_t pitchRise[] = {1, 0, 3};
+static const int8_t pitchFall[] = {1, 0, -3};
+static const int8_t pitchDrop[] = {5, MACRO_NO_LOOP, -24, -16, -8, -4, 0};
+static const int8_t pitchBlip[] = {3, MACRO_NO_LOOP, 48, -48, 0};
+
+// noise modes, see the psg noise track
+static const int8_t noiseHat[] = {3, MACRO_NO_LOOP, 4, 4, 5};
+static const int8_t noiseSnare[] = {4, MACRO_NO_LOOP, 6, 5, 5, 4};
+static const int8_t noiseSweep[] = {3, 0, 4, 5, 6};
+static const int8_t noiseBuzz[] = {2, 0, 3, 7};
+static const int8_t noiseCrush[] = {4, 0, 0, 4, 1, 5};
+
+static const int8_t *const macroBank[MACRO_TYPE_COUNT][MACRO_BANK_SIZE] = {
+  {0, arpMajor, arpMinor, arpOctave, arpPower, arpDim},
+  {0, pitchWobble, pitchRise, pitchFall, pitchDrop, pitchBlip},
+  {0, noiseHat, noiseSnare, noiseSweep, noiseBuzz, noiseCrush}
+};
+
+static const char *const macroNames[MACRO_TYPE_COUNT][MACRO_BANK_SIZE] = {
+  {"none ", "major", "minor", "oct  ", "power", "dim  "},
+  {"none ", "wobbl", "rise ", "fall ", "drop ", "blip "},
+  {"none ", "hat  ", "snare", "sweep", "buzz ", "crush"}
+};
+
+void macro_start(macro_t *m, uint8_t type, uint8_t index) {
+  m->data = index < MACRO_BANK_SIZE ? macroBank[type][index] : 0;
+  m->pos = 0;
+}
+
+// the value for this frame, a fixed amount of work whatever the macro
+int8_t macro_next(macro_t *m) {
+  const int8_t *d = m->data;
+  int8_t value;
+
+  if (!d) return 0;
+
+  value = d[2 + m->pos];
+  if (m->pos + 1 < d[0]) {
+    m->pos++;
+  } else if (d[1] != MACRO_NO_LOOP) {
+    m->pos = d[1];
+  }
+  return value;
+}
+
+const char *macro_name(uint8_t type, uint8_t index) {
+  return macroNames[type][index < MACRO_BANK_SIZE ? index : 0];
+}
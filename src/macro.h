@@ -0,0 +1,27 @@
+#ifndef H_MACRO
+#define H_MACRO
+
+#include <stdint.h>
+
+// instrument macros: one value per frame from a short byte sequence.
+// a sequence is: length, loop position, then the values. with the loop
+// position at MACRO_NO_LOOP the last value is held once the end is reached
+#define MACRO_NO_LOOP 127
+
+#define MACRO_ARP 0   // semitones added to the note
+#define MACRO_PITCH 1 // added to the pitch every frame, fine steps on fm, counter steps on psg
+#define MACRO_NOISE 2 // psg noise mode 0-7, replaces the mode of the note
+#define MACRO_TYPE_COUNT 3
+
+#define MACRO_BANK_SIZE 6 // per type, entry 0 is always "none"
+
+typedef struct {
+  const int8_t *data; // 0 when the channel has no macro of this type
+  uint8_t pos;
+} macro_t;
+
+void macro_start(macro_t *m, uint8_t type, uint8_t index);
+int8_t macro_next(macro_t *m);
+const char *macro_name(uint8_t type, uint8_t index);
+
+#endif
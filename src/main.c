@@ -4,7 +4,15 @@
 #include "z80driver.h" // z80 driver
 #include "rx21kit.h" // sound samples
 #include "psg.h"
+#include "psgenv.h"
 #include "ym2612.h"
+#include "ymvoice.h"
+#include "ympatches.h" // generated from patches/ by tools/fmimport
+#include "macro.h"
+#include "plock.h"
+#include "groove.h"
+#include "trig.h"
+#include "pool.h"
 
 #include <stdint.h>
 
@@ -57,14 +65,139 @@ const uint32_t gradTile[8] = {
                     // used by the 68000 to set the bank, start address and length
 
 /* sequencer stuff */
-// gate / sample number sequence
-int gateseq[16] = {1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-int accseq[16] = {1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0}; // accent sequence
-int speedseq[16] = {20,21,22,30,29,28,10,12,14,15,13,11,9,8,7,6}; // playback speed sequence
-int seqpos = 0; // current playback sequence position
+// every track has a pool of patterns. the sequencer screens edit one pattern
+// per track through the *seq pointers, the song plays a row of patterns at a time
+#define TRACK_PCM 0
+#define TRACK_PSG 1
+#define TRACK_YM 2
+#define TRACK_YM3 3
+#define TRACK_COUNT 4
+#define PATTERN_COUNT 16 // per track, only the ones with something in them take ram
+#define PATTERN_STEPS_MAX 64
+#define PATTERN_LENGTH_DEFAULT 16
+#define PAGE_STEPS 16 // steps on screen at once
+#define STEP_ROW(step) ((step) & (PAGE_STEPS - 1))
+#define PAGE_FIRST(step) ((step) & ~(PAGE_STEPS - 1))
+#define PCM_SPEED_DEFAULT 20
+
+// where each sample of the kit sits in rx21kit_raw, by pcm step sample number
+typedef struct {
+  uint16_t start;
+  uint16_t length;
+} sample_entry_t;
+
+static const sample_entry_t sampleDir[sampleMax + 1] = {
+  {0, 0},
+  {0, 659}, // 1 - clap
+  {659, 7761}, // 2 - cymbal
+  {659+7761, 863}, // 3 - hat closed
+  {659+7761+863, 4299}, // 4 - hat open
+  {659+7761+863+4299, 662}, // 5 - kick
+  {659+7761+863+4299+662, 1058}, // 6 - snare
+  {659+7761+863+4299+662+1058, 1585}, // 7 - tom high
+  {659+7761+863+4299+662+1058+1585, 1585}, // 8 - tom low
+  {659+7761+863+4299+662+1058+1585+1585, 1607} // 9 - tom mid
+};
+#define PCM_STEP_ACCENT 0x01
+
+// one pcm step: sample number (0 for none), flags and playback speed
+typedef struct {
+  uint8_t sample;
+  uint8_t flags;
+  uint8_t speed;
+} pcm_step_t;
+
+// what the first pattern of a new sequence starts with
+static const pcm_step_t pcmDemo[PATTERN_LENGTH_DEFAULT] = {
+  {1, PCM_STEP_ACCENT, 20}, {0, 0, 21}, {0, 0, 22}, {0, 0, 30},
+  {0, PCM_STEP_ACCENT, 29}, {0, 0, 28}, {0, 0, 10}, {0, 0, 12},
+  {0, PCM_STEP_ACCENT, 14}, {0, 0, 15}, {0, 0, 13}, {0, 0, 11},
+  {0, PCM_STEP_ACCENT, 9}, {0, 0, 8}, {0, 0, 7}, {0, 0, 6}
+};
+pcm_step_t *pcmSeq; // steps of the edited pattern, see bind_edit_patterns
+uint8_t patternLength[TRACK_COUNT][PATTERN_COUNT];
+uint8_t editPattern[TRACK_COUNT] = {0}; // pattern each sequencer screen shows
+
+// the arrangement: a list of rows naming one pattern per track. a row lasts
+// as long as its longest pattern, shorter ones loop until it ends
+#define SONG_LENGTH_MAX 32
+uint8_t song[SONG_LENGTH_MAX][TRACK_COUNT] = {{0}};
+uint8_t songLength = 1;
+uint8_t songMode = 0; // 0 loops the edited patterns, 1 plays the song
+volatile uint8_t songpos = 0; // row playing
+
 //int framemod = 11; // how many frames to wait before the next sequencer step
-int tempo = 11;
-int tempo_old = -1;
+// tempo in tenths of a bpm. the clock runs SEQ_PPQN ticks per beat and a step
+// is a sixteenth note, swing and nudges move tracks by whole ticks within it
+#define BPM_MIN 300
+#define BPM_MAX 3000
+#define SEQ_PPQN 96
+#define SEQ_TICKS_PER_STEP (SEQ_PPQN / 4)
+#define SWING_MAX 12 // ticks the odd steps are held back, half a step
+uint8_t seq_swing = 0;
+uint8_t seq_swing_old = 255;
+uint8_t seq_groove = 0; // groove template, 0 is straight
+uint8_t seq_groove_old = 255;
+// how fast each pattern steps, in clock ticks per step, x1 being a sixteenth
+#define RATE_COUNT 8
+#define RATE_DEFAULT 3
+static const uint8_t rateTicks[RATE_COUNT] = {6, 12, 16, 24, 32, 48, 72, 96};
+static const char *const rateNames[RATE_COUNT] = {
+  "x4  ", "x2  ", "x3/2", "x1  ", "x3/4", "/2  ", "/3  ", "/4  "
+};
+uint8_t patternRate[TRACK_COUNT][PATTERN_COUNT];
+uint16_t bpm = 1200;
+uint16_t bpm_old = 0xFFFF;
+uint32_t clockAcc = 0; // time since the last tick, see seq_clock_advance
+uint8_t stepTicks = 0; // ticks into the sixteenth, playback starts on a boundary
+volatile uint16_t clockTicks = 0; // every tick so far, the main loop measures frames with it
+// the sequencer is clocked either by the frame count or by ym timer A
+#define SEQ_CLOCK_VSYNC 0
+#define SEQ_CLOCK_TIMER_A 1
+uint8_t seq_clock = SEQ_CLOCK_VSYNC;
+uint8_t seq_clock_old = 255;
+uint16_t timer_a_value = 136; // 888 counts of 18.77us, overflows about once a frame
+uint16_t timer_a_value_old = 0xFFFF;
+uint16_t timerCounting = 0; // the value the timer is counting down now, edits apply from the next overflow
+uint16_t timerJitter = 0; // worst tick latency seen in scanlines
+uint16_t timerJitter_old = 0xFFFF;
+#define TIMER_POLL_LINES 4 // scanlines between timer polls, each poll holds the z80 bus
+uint8_t hint_clock = SEQ_CLOCK_VSYNC; // the clock the horizontal interrupt is set up for
+uint8_t timerPollLine = 0; // scanline of the last timer A poll
+#define SAVE_IDLE_FRAMES 30
+uint8_t saveIdle = 0; // frames left until the pending save is written, 0 when there is none
+uint16_t ymWritesOld = 0; // 68k cycles per register write through the old write path
+uint16_t ymWritesTuned = 0; // and through the tuned one, measured at boot
+uint8_t ymResetLines = 0; // scanlines the boot YM2612_reset took
+volatile uint8_t meterLevel = 0; // pcm output level, read by the vblank handler
+
+// ui edits that need the sound chips are handed to the vblank handler, which
+// owns them. the ui only moves soundHead and the handler only moves
+// soundTail, so neither side has to mask interrupts
+#define SOUND_QUEUE_SIZE 32 // power of two
+volatile uint16_t soundQueue[SOUND_QUEUE_SIZE]; // command | argument << 8
+volatile uint8_t soundHead = 0;
+volatile uint8_t soundTail = 0;
+
+#define SOUND_LFO 0
+#define SOUND_DETUNE_MULT 1
+#define SOUND_LEVEL 2 // argument is channel * 4 + operator
+#define SOUND_SSGEG 3 // argument is channel * 4 + operator
+#define SOUND_ATTACK 4
+#define SOUND_RELEASE_SUSTAIN 5
+#define SOUND_DECAY_AM 6
+#define SOUND_FEEDBACK_ALGO 7
+#define SOUND_PAN_AMS_FMS 8
+#define SOUND_INSTRUMENT 9
+#define SOUND_PITCH_MOD 10
+#define SOUND_LEGATO 11
+#define SOUND_MACROS 12
+#define SOUND_CH3_MODE 13
+#define SOUND_SEQ_CLOCK 14
+#define SOUND_STOP 15
+#define SOUND_PANIC 16
+#define SOUND_START 17
+#define SOUND_TIMER_A 18
 
 /* gui stuff */
 int column = 0; // editing column
@@ -72,14 +205,93 @@ int oldcolumn = 0; // last editing column to check for A button press change
 #define COLUMN_COUNT 3 // number of columns
 int screen = 0; // whether we're viewing the pcm or psg screen
 int oldscreen = -1;
-#define SCREEN_COUNT 5 // number of different screens to switch through by pressing the B button
+#define SCREEN_COUNT 9 // number of different screens to switch through by pressing the B button
 #define SCREEN_PCM_SEQ 0
 #define SCREEN_PSG_SEQ 1
 #define SCREEN_YM_SEQ 2
-#define SCREEN_YM_INST 3
-#define SCREEN_PROJECT 4
-int playing = 0; // whether to advance the sequencer
+#define SCREEN_YM3_SEQ 3
+#define SCREEN_YM_INST 4
+#define SCREEN_PROJECT 5
+#define SCREEN_PSG_INST 6
+#define SCREEN_SONG 7
+#define SCREEN_LOCKS 8
+volatile uint8_t playing = 0; // whether to advance the sequencer, only vblank_handler sets it
+volatile uint8_t fillMode = 0; // held with A and up, fill trigs play and !fill ones don't
+// live record: A on a sequencer screen copies the cell under the cursor to
+// the step playing when it was pressed
+#define REC_TRIM_MAX 24
+uint8_t recording = 0;
+uint8_t recording_old = 255;
+uint8_t recTrim = 0; // ticks taken off on top of the pad delay, for the sound reaching the player
+uint8_t recTrim_old = 255;
+uint8_t pollTicks = 0; // ticks between the last two pad reads
+uint16_t lastPollTicks = 0;
+/* project gui */
+int project_select_field = 0;
+int project_select_field_old = -1;
+#define PROJECT_FIELD_TEMPO 0
+#define PROJECT_FIELD_CH3 1
+#define PROJECT_FIELD_CLOCK 2
+#define PROJECT_FIELD_TIMER_A 3
+#define PROJECT_FIELD_BPM_FINE 4
+#define PROJECT_FIELD_SONG_MODE 5
+#define PROJECT_FIELD_SONG_LENGTH 6
+#define PROJECT_FIELD_PATTERN 7 // one field per track
+#define PROJECT_FIELD_LENGTH 11 // length of the pattern above, one per track
+#define PROJECT_FIELD_SWING 15
+#define PROJECT_FIELD_GROOVE 16
+#define PROJECT_FIELD_RATE 17 // rate of the edited pattern, one per track
+#define PROJECT_FIELD_RECORD 21
+#define PROJECT_FIELD_REC_TRIM 22
+#define PROJECT_FIELD_COUNT 23
+uint8_t songMode_old = 255;
+uint8_t songLength_old = 255;
+uint8_t editPattern_old[4] = {255, 255, 255, 255};
+uint8_t patternLength_old[4] = {255, 255, 255, 255};
+uint8_t patternRate_old[4] = {255, 255, 255, 255};
+uint8_t blocksFree_old[TRACK_COUNT + 1] = {255, 255, 255, 255, 255}; // then the lock lists
+uint16_t ramFree_old = 0;
 int playingCanChange = 1;
+/* psg inst gui */
+int psg_select_field = 0;
+int psg_select_field_old = -1;
+#define PSG_FIELD_TRACK 0
+#define PSG_FIELD_ATTACK 1
+#define PSG_FIELD_DECAY 2
+#define PSG_FIELD_SUSTAIN 3
+#define PSG_FIELD_RELEASE 4
+#define PSG_FIELD_ARP 5
+#define PSG_FIELD_PITCH 6
+#define PSG_FIELD_NOISE 7
+#define PSG_FIELD_COUNT 8
+uint8_t psg_track = 0; // track whose envelope is being edited
+psgenv_shape_t psg_shape_old = {255, 255, 255, 255, 255, 255, 255};
+uint8_t psg_track_old = 255;
+/* lock gui */
+int lock_select_field = 0;
+int lock_select_field_old = -1;
+#define LOCK_FIELD_TRACK 0
+#define LOCK_FIELD_STEP 1
+#define LOCK_FIELD_PARAM 2
+#define LOCK_FIELD_VALUE 3
+#define LOCK_FIELD_COUNT 4
+#define LOCK_LIST_ROW 6 // the locks of the pattern are listed from here down
+uint8_t lock_track = TRACK_YM;
+uint8_t lock_track_old = 255;
+uint8_t lock_step = 0;
+uint8_t lock_step_old = 255;
+uint8_t lock_param = PLOCK_TL;
+uint8_t lock_param_old = 255;
+int16_t lock_value_old = -2;
+uint8_t lockListStale = 1; // set by lock edits, the list is printed again
+// params each track can lock, bit n for param n
+#define LOCK_ANY_MASK ((1 << PLOCK_NUDGE) | (1 << PLOCK_COND))
+#define LOCK_FM_MASK ((1 << PLOCK_TL) | (2 << PLOCK_TL) | (4 << PLOCK_TL) | (8 << PLOCK_TL) | \
+		      (1 << PLOCK_FEEDBACK) | LOCK_ANY_MASK)
+static const uint16_t trackLockMask[TRACK_COUNT] = {
+  (1 << PLOCK_RATE) | LOCK_ANY_MASK, (1 << PLOCK_VOLUME) | LOCK_ANY_MASK,
+  LOCK_FM_MASK, LOCK_FM_MASK
+};
 /* ym inst gui */
 int ym_select_field = 0;
 int ym_select_field_old = -1;
@@ -100,9 +312,19 @@ int ym_select_field_old = -1;
 #define YM_FIELD_FMS 14
 #define YM_FIELD_OP 15
 #define YM_FIELD_CHAN 16
-#define YM_FIELD_COUNT 17
+#define YM_FIELD_GLIDE 17
+#define YM_FIELD_VIB_SPEED 18
+#define YM_FIELD_VIB_DEPTH 19
+#define YM_FIELD_BEND 20
+#define YM_FIELD_SSGEG 21
+#define YM_FIELD_PATCH 22
+#define YM_FIELD_LEGATO 23
+#define YM_FIELD_ARP 24
+#define YM_FIELD_PITCH_MACRO 25
+#define YM_FIELD_COUNT 26
+
+#define STATUS_ROW 27 // below the longest field list and the level meter
 #define YM_OP_COUNT 4
-#define YM_CHAN_COUNT 6
 #define YM_OP_CHAN_COUNT (YM_OP_COUNT*YM_CHAN_COUNT)
 uint8_t ym_lfo_enable = 0;
 uint8_t ym_lfo_enable_old = 255;
@@ -114,6 +336,10 @@ uint8_t ym_mult = 1;
 uint8_t ym_mult_old = 1;
 uint8_t ym_level[YM_OP_CHAN_COUNT] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
 uint8_t ym_level_old = 255;
+// ssg-eg per operator, 0 is off and 1-8 are the eight hardware shapes
+#define YM_SSGEG_MAX 8
+uint8_t ym_ssgeg[YM_OP_CHAN_COUNT] = {0};
+uint8_t ym_ssgeg_old = 255;
 uint8_t ym_attack = 0x1F;
 uint8_t ym_attack_old = 255;
 uint8_t ym_release = 0xF;
@@ -138,18 +364,321 @@ uint8_t ym_op = 3;
 uint8_t ym_op_old = 0;
 uint8_t ym_chan = 0;
 uint8_t ym_chan_old = 5;
+uint8_t ym_glide = 0;
+uint8_t ym_glide_old = 255;
+uint8_t ym_vib_speed = 0;
+uint8_t ym_vib_speed_old = 255;
+uint8_t ym_vib_depth = 0;
+uint8_t ym_vib_depth_old = 255;
+int8_t ym_bend = 0;
+int8_t ym_bend_old = -128;
+uint8_t ym_legato = 0; // held lanes only restart their carriers
+uint8_t ym_legato_old = 255;
+uint8_t ym_patch = 0; // bank patch under the fields, 0 for none
+uint8_t ym_patch_old = 255;
+uint8_t ym_arp = 0; // macro bank entries, see macro.c
+uint8_t ym_arp_old = 255;
+uint8_t ym_pitch_macro = 0;
+uint8_t ym_pitch_macro_old = 255;
+uint8_t ym_ch3_special = 0; // channel 3 runs the four operator track instead of taking chord voices
+uint8_t ym_ch3_special_old = 255;
 
 /* psg sequencer */
-int psgNoteSeq[16] = {20,0,22,0,29,28,0,0,14,15,0,11,0,0,7,6}; // playback speed sequence
+// three tone tracks and the noise track, each with a note lane and a volume lane
+#define PSG_TRACK_COUNT 4
+#define PSG_NOISE_TRACK 3
+#define PSG_NOISE_MODES 8 // periodic/white times clock/2, /4, /8 or tone 3
+#define PSG_COLUMN_COUNT (PSG_TRACK_COUNT * 2)
+#define PSG_VOLUME_DEFAULT 10 // what a 0 in the volume lane plays at
+typedef struct {
+  int8_t note[PSG_TRACK_COUNT]; // note + 1 or noise mode + 1, 0 is a note off
+  int8_t vol[PSG_TRACK_COUNT];  // 1-15 loudness, 0 default, -1 sets the pitch silently
+} psg_step_t;
+
+static const psg_step_t psgDemo[PATTERN_LENGTH_DEFAULT] = {
+  {{20}, {0}}, {{0}, {0}}, {{22}, {0}}, {{0}, {0}},
+  {{29}, {0}}, {{28}, {0}}, {{0}, {0}}, {{0}, {0}},
+  {{14}, {0}}, {{15}, {0}}, {{0}, {0}}, {{11}, {0}},
+  {{0}, {0}}, {{0}, {0}}, {{7}, {0}}, {{6}, {0}}
+};
+psg_step_t *psgSeq;
 
 /* ym sequencer */
-int ymNoteSeq[16] = {20,0,22,0,29,28,0,0,14,15,0,11,0,0,7,6}; // playback speed sequence
+// each step is a chord of up to YM_CHORD_MAX notes, -1 in the first lane is a note off
+#define YM_STEP_CHORD ((1 << YM_CHORD_MAX) - 1) // lanes with a note, compiled into keys
+#define YM_STEP_OFF 0x80 // -1 in the first lane
+
+typedef struct {
+  int8_t note[YM_CHORD_MAX];
+  uint8_t keys; // compiled by ym_step_compile
+} ym_step_t;
+
+static const ym_step_t ymDemo[PATTERN_LENGTH_DEFAULT] = {
+  {{20}, 0}, {{0}, 0}, {{22}, 0}, {{0}, 0},
+  {{29}, 0}, {{28}, 0}, {{0}, 0}, {{0}, 0},
+  {{14}, 0}, {{15}, 0}, {{0}, 0}, {{11}, 0},
+  {{0}, 0}, {{0}, 0}, {{7}, 0}, {{6}, 0}
+};
+ym_step_t *ymSeq;
+
+/* ym channel 3 special mode sequencer */
+// one note lane per operator, each operator is an independent sine voice
+#define YM3_OP_COUNT 4
+#define YM3_FB_ALGO 0x07 // 0xB0 of channel 3 in special mode
+typedef struct {
+  int8_t note[YM3_OP_COUNT]; // -1 releases the operator
+  // compiled by ym3_step_compile
+  uint8_t on;  // operators keyed on
+  uint8_t off; // operators released
+  uint16_t regs[YM3_OP_COUNT]; // A4:A0 bytes of the operators keyed on
+} ym3_step_t;
+
+ym3_step_t *ym3Seq;
+uint8_t ym3KeyMask = 0; // channel 3 operators currently keyed on
+
+/* pattern memory */
+// the steps of a pattern are one block from the pool of its track, taken
+// when the pattern is first edited. the others point at the track's blank
+// pattern, so a pattern costs ram only once it has something in it. lock
+// lists work the same way. the pools have to fit ARENA_SIZE, checked below
+#define PCM_BLOCKS 16
+#define PSG_BLOCKS 8
+#define YM_BLOCKS 12
+#define YM3_BLOCKS 4
+#define LOCK_BLOCKS 24
+static const uint8_t trackBlocks[TRACK_COUNT] = {PCM_BLOCKS, PSG_BLOCKS, YM_BLOCKS, YM3_BLOCKS};
+static const uint16_t trackStepSize[TRACK_COUNT] = {
+  sizeof(pcm_step_t), sizeof(psg_step_t), sizeof(ym_step_t), sizeof(ym3_step_t)
+};
+pool_t stepPools[TRACK_COUNT];
+pool_t lockPool;
+void *blankSteps[TRACK_COUNT];
+plock_list_t noLocks; // the list of every pattern without locks, always empty
+void *patternSteps[TRACK_COUNT][PATTERN_COUNT];
+plock_list_t *patternLocks[TRACK_COUNT][PATTERN_COUNT];
+#define PATTERN_BYTES(track) (trackStepSize[track] * PATTERN_STEPS_MAX)
+// a track takes its pool and one blank pattern from the arena
+#define TRACK_ARENA_BYTES(step, blocks) POOL_BYTES(sizeof(step) * PATTERN_STEPS_MAX, (blocks) + 1)
+_Static_assert(TRACK_ARENA_BYTES(pcm_step_t, PCM_BLOCKS) + TRACK_ARENA_BYTES(psg_step_t, PSG_BLOCKS) +
+	       TRACK_ARENA_BYTES(ym_step_t, YM_BLOCKS) + TRACK_ARENA_BYTES(ym3_step_t, YM3_BLOCKS) +
+	       POOL_BYTES(sizeof(plock_list_t), LOCK_BLOCKS) <= ARENA_SIZE,
+	       "the pattern pools don't fit ARENA_SIZE");
+
+/* song playback */
+// a row with its pattern data already looked up
+typedef struct {
+  const pcm_step_t *pcm;
+  const psg_step_t *psg;
+  const ym_step_t *ym;
+  const ym3_step_t *ym3;
+  const plock_list_t *locks[TRACK_COUNT];
+  uint8_t pattern[TRACK_COUNT];
+  uint8_t length[TRACK_COUNT];
+  uint8_t ticks[TRACK_COUNT]; // clock ticks per step
+  uint16_t rowTicks; // the longest pattern, in clock ticks
+  uint8_t row;
+} song_row_t;
+
+song_row_t playRow; // patterns playing now
+song_row_t nextRow; // looked up ahead so the switch is only a copy
+volatile uint8_t nextRowStale = 1; // set by edits, vblank_handler looks the row up again
+volatile uint8_t trackPos[TRACK_COUNT] = {0}; // step of each track in its pattern
+volatile uint8_t trackTick[TRACK_COUNT] = {0}; // ticks into that step, at the track's own rate
+uint16_t rowTick = 0; // ticks into the row
+trig_loops_t trackLoops[TRACK_COUNT]; // passes through each pattern, for the a:b trigs
+// the step each track is on: its locks, the tick it is due on and the tracks
+// that haven't fired yet
+plock_step_t stepLocks[TRACK_COUNT];
+uint8_t trackDue[TRACK_COUNT];
+uint8_t pendingTracks = 0;
+uint8_t seqStarted = 0; // set once playback lined up with a sixteenth
+
+// work out what a step sends once, when it is edited, so the sequencer only
+// reads prepared masks and register bytes
+void ym_step_compile(ym_step_t *step) {
+  step->keys = step->note[0] == -1 ? YM_STEP_OFF : 0;
+  for (int n = 0; n < YM_CHORD_MAX; n++) {
+    if (step->note[n] > 0) step->keys |= 1 << n;
+  }
+}
+
+void ym3_step_compile(ym3_step_t *step) {
+  step->on = 0;
+  step->off = 0;
+  for (int op = 0; op < YM3_OP_COUNT; op++) {
+    step->regs[op] = 0;
+    if (step->note[op] > 0) {
+      step->on |= 1 << op;
+      step->regs[op] = ym_pitch_regs(step->note[op] * YM_PITCH_FINE);
+    } else if (step->note[op] == -1) {
+      step->off |= 1 << op;
+    }
+  }
+}
+
+// every step of every pattern with a block, after a load. blank steps
+// compile to nothing, which is what they already hold
+void patterns_compile() {
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    ym_step_t *ym = patternSteps[TRACK_YM][p];
+    ym3_step_t *ym3 = patternSteps[TRACK_YM3][p];
+    for (int i = 0; i < PATTERN_STEPS_MAX; i++) {
+      if (ym != blankSteps[TRACK_YM]) ym_step_compile(&ym[i]);
+      if (ym3 != blankSteps[TRACK_YM3]) ym3_step_compile(&ym3[i]);
+    }
+  }
+}
+
+// the steps of a pattern, with a block of their own first so they can be
+// written. 0 when the pool of the track is used up
+static void *pattern_claim(uint8_t track, uint8_t pattern) {
+  void *steps = patternSteps[track][pattern];
+
+  if (steps == blankSteps[track]) {
+    steps = pool_alloc(&stepPools[track]);
+    if (!steps) return 0;
+    memcpy(steps, blankSteps[track], PATTERN_BYTES(track));
+    patternSteps[track][pattern] = steps;
+  }
+  return steps;
+}
+
+// the same for the lock list of a pattern
+static plock_list_t *locks_claim(uint8_t track, uint8_t pattern) {
+  plock_list_t *list = patternLocks[track][pattern];
+
+  if (list == &noLocks) {
+    list = pool_alloc(&lockPool);
+    if (!list) return 0;
+    plock_clear(list);
+    patternLocks[track][pattern] = list;
+  }
+  return list;
+}
+
+// every pattern back to blank, its blocks back to the pools
+static void patterns_release() {
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+      if (patternSteps[t][p] != blankSteps[t]) pool_free(&stepPools[t], patternSteps[t][p]);
+      if (patternLocks[t][p] != &noLocks) pool_free(&lockPool, patternLocks[t][p]);
+      patternSteps[t][p] = blankSteps[t];
+      patternLocks[t][p] = &noLocks;
+    }
+  }
+}
+
+extern uint8_t _end[]; // end of the globals, from megadrive.ld
+
+// ram nothing uses yet, between the end of the globals and the stack
+uint16_t ram_free() {
+  uint8_t here;
+
+  return (uint32_t)&here - (uint32_t)_end;
+}
+
+void pattern_memory_full() {
+  vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+  vdp_puts(VDP_PLAN_A, "out of pattern memory", 3, STATUS_ROW);
+}
+
+// point the sequencer screens at the patterns picked on the project screen.
+// 0 when one of them has no block left, the screens keep what they showed
+uint8_t bind_edit_patterns() {
+  void *steps[TRACK_COUNT];
+
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    steps[t] = pattern_claim(t, editPattern[t]);
+    if (!steps[t]) return 0;
+  }
+  pcmSeq = steps[TRACK_PCM];
+  psgSeq = steps[TRACK_PSG];
+  ymSeq = steps[TRACK_YM];
+  ym3Seq = steps[TRACK_YM3];
+  nextRowStale = 1;
+  return 1;
+}
+
+// the pools, every pattern blank, lengths and rates at their defaults and
+// the first patterns holding the demo sequence. once, at start up
+void patterns_init() {
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    if (!pool_init(&stepPools[t], PATTERN_BYTES(t), trackBlocks[t])) {
+      error_fatal("pattern pools don't fit the arena");
+    }
+    blankSteps[t] = arena_alloc(PATTERN_BYTES(t)); // zeroed with the rest of ram
+    if (!blankSteps[t]) error_fatal("blank patterns don't fit the arena");
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+      patternSteps[t][p] = blankSteps[t];
+      patternLocks[t][p] = &noLocks;
+      patternLength[t][p] = PATTERN_LENGTH_DEFAULT;
+      patternRate[t][p] = RATE_DEFAULT;
+    }
+  }
+  if (!pool_init(&lockPool, sizeof(plock_list_t), LOCK_BLOCKS)) {
+    error_fatal("lock pool doesn't fit the arena");
+  }
+  for (int i = 0; i < PATTERN_STEPS_MAX; i++) {
+    ((pcm_step_t *)blankSteps[TRACK_PCM])[i].speed = PCM_SPEED_DEFAULT;
+  }
+
+  bind_edit_patterns();
+  memcpy(pcmSeq, pcmDemo, sizeof(pcmDemo));
+  memcpy(psgSeq, psgDemo, sizeof(psgDemo));
+  memcpy(ymSeq, ymDemo, sizeof(ymDemo));
+  patterns_compile();
+}
+
+// look up the patterns of a song row, or of the edited patterns when looping
+static void song_resolve(uint8_t row, song_row_t *r) {
+  r->row = row;
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    r->pattern[t] = songMode ? song[row][t] : editPattern[t];
+  }
+  r->pcm = patternSteps[TRACK_PCM][r->pattern[TRACK_PCM]];
+  r->psg = patternSteps[TRACK_PSG][r->pattern[TRACK_PSG]];
+  r->ym = patternSteps[TRACK_YM][r->pattern[TRACK_YM]];
+  r->ym3 = patternSteps[TRACK_YM3][r->pattern[TRACK_YM3]];
+
+  r->rowTicks = 0;
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    uint16_t ticks;
+    r->locks[t] = patternLocks[t][r->pattern[t]];
+    r->length[t] = patternLength[t][r->pattern[t]];
+    r->ticks[t] = rateTicks[patternRate[t][r->pattern[t]]];
+    ticks = r->length[t] * r->ticks[t];
+    if (ticks > r->rowTicks) r->rowTicks = ticks;
+  }
+}
+
+// the row after the one playing
+static void song_resolve_next() {
+  uint8_t row = 0;
+
+  if (songMode && playRow.row + 1 < songLength) row = playRow.row + 1;
+  song_resolve(row, &nextRow);
+}
+
+// back to the first row, called before playback starts
+void song_rewind() {
+  song_resolve(0, &playRow);
+  song_resolve_next();
+  nextRowStale = 0;
+  songpos = 0;
+  rowTick = 0;
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    trackPos[t] = 0;
+    trackTick[t] = 0;
+    trig_loops_reset(&trackLoops[t]);
+  }
+  pendingTracks = 0;
+  seqStarted = 0;
+}
 
 
 void set_ym_lfo(uint8_t enable, uint8_t speed) {
   Z80_requestBus(1);
-  YM2612_write(0, 0x22);
-  YM2612_write(1, (enable << 3) | (speed & 0x07));
+  ym_write(0, 0x22, (enable << 3) | (speed & 0x07));
   YM2612_latchDacDataReg();
   Z80_releaseBus();  
 }
@@ -157,7 +686,10 @@ void set_ym_lfo(uint8_t enable, uint8_t speed) {
 void set_ym_detune_mult(uint8_t detune, uint8_t mult) {
   Z80_requestBus(1);
   uint8_t val = ((detune & 0x07) << 4) | (mult & 0x0F);
-  ym_write(0, 0x3C, val); // DT1/Multi: Multiplier 1 ch0 op4
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    ym_write_op(ch, 3, 0x30, val); // DT1/Multi op4
+  }
   YM2612_latchDacDataReg();
   Z80_releaseBus();  
 }
@@ -167,128 +699,38 @@ void set_ym_level(uint8_t channel, uint8_t operator, uint8_t level) {
   Z80_requestBus(1);
 
   uint8_t val = level & 0x7F;
-  
-  switch (channel) {
-  case 0:
-    switch (operator) {
-    case 0:
-      ym_write(0, 0x40, val);
-      break;
-    case 1:
-      ym_write(0, 0x48, val);
-      break;
-    case 2:
-      ym_write(0, 0x44, val);
-      break;
-    case 3:
-      ym_write(0, 0x4C, val);
-      break;
-    default:
-      break;
-    }
-    break;
-  case 1:
-    switch (operator) {
-    case 0:
-      ym_write(0, 0x41, val);
-      break;
-    case 1:
-      ym_write(0, 0x49, val);
-      break;
-    case 2:
-      ym_write(0, 0x45, val);
-      break;
-    case 3:
-      ym_write(0, 0x4D, val);
-      break;
-    default:
-      break;
-    }    
-    break;
-  case 2:
-    switch (operator) {
-    case 0:
-      ym_write(0, 0x42, val);
-      break;
-    case 1:
-      ym_write(0, 0x4A, val);
-      break;
-    case 2:
-      ym_write(0, 0x46, val);
-      break;
-    case 3:
-      ym_write(0, 0x4E, val);
-      break;
-    default:
-      break;
-    }        
-    break;
-  case 3:
-    switch (operator) {
-    case 0:
-      ym_write(1, 0x40, val);
-      break;
-    case 1:
-      ym_write(1, 0x48, val);
-      break;
-    case 2:
-      ym_write(1, 0x44, val);
-      break;
-    case 3:
-      ym_write(1, 0x4C, val);
-      break;
-    default:
-      break;
-    }    
-    break;
-  case 4:
-    switch (operator) {
-    case 0:
-      ym_write(1, 0x41, val);
-      break;
-    case 1:
-      ym_write(1, 0x49, val);
-      break;
-    case 2:
-      ym_write(1, 0x45, val);
-      break;
-    case 3:
-      ym_write(1, 0x4D, val);
-      break;
-    default:
-      break;
-    }        
-    break;
-  case 5:
-    switch (operator) {
-    case 0:
-      ym_write(1, 0x42, val);
-      break;
-    case 1:
-      ym_write(1, 0x4A, val);
-      break;
-    case 2:
-      ym_write(1, 0x46, val);
-      break;
-    case 3:
-      ym_write(1, 0x4E, val);
-      break;
-    default:
-      break;
-    }            
-    break;
-  default:
-    break;
+
+  if (channel < YM_CHAN_COUNT && operator < YM_OP_COUNT) {
+    ym_set_tl(channel, operator, val);
   }
 
   YM2612_latchDacDataReg();
   Z80_releaseBus();  
 }
 
+void set_ym_ssgeg(uint8_t channel, uint8_t operator, uint8_t mode) {
+
+  Z80_requestBus(1);
+
+  // bit 3 enables ssg-eg, bits 2-0 are the attack/alternate/hold shape
+  uint8_t val = mode ? 0x08 | ((mode - 1) & 0x07) : 0x00;
+
+  if (channel < YM_CHAN_COUNT && operator < YM_OP_COUNT) {
+    ym_write_op(channel, operator, 0x90, val);
+  }
+
+  YM2612_latchDacDataReg();
+  Z80_releaseBus();  
+}
+
+// the rest of the instrument goes to every voice so allocated notes sound alike
 void set_ym_attack(uint8_t attack) {
   Z80_requestBus(1);
   uint8_t val = attack & 0x1F;
-  ym_write(0, 0x5C, val);
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    ym_write_op(ch, 3, 0x50, val);
+  }
   YM2612_latchDacDataReg();
   Z80_releaseBus();  
 }
@@ -296,7 +738,10 @@ void set_ym_attack(uint8_t attack) {
 void set_ym_release_sustain(uint8_t release, uint8_t sustain) { // sustain - 0 is max, 15 is none
   Z80_requestBus(1);
   uint8_t val = ((sustain & 0xF) << 4) | (release & 0xF);
-  ym_write(0, 0x8C, val);
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    ym_write_op(ch, 3, 0x80, val);
+  }
   YM2612_latchDacDataReg();
   Z80_releaseBus();  
 }
@@ -304,7 +749,10 @@ void set_ym_release_sustain(uint8_t release, uint8_t sustain) { // sustain - 0 i
 void set_ym_decay_am(uint8_t decay, uint8_t amenable) {
   Z80_requestBus(1);
   uint8_t val = (decay & 0x1F) | ((amenable & 0x1) << 7);
-  ym_write(0, 0x6C, val);
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    ym_write_op(ch, 3, 0x60, val);
+  }
   YM2612_latchDacDataReg();
   Z80_releaseBus();  
 }
@@ -312,19 +760,140 @@ void set_ym_decay_am(uint8_t decay, uint8_t amenable) {
 void set_ym_feedback_algo(uint8_t feedback, uint8_t algo) {
   Z80_requestBus(1);
   uint8_t val = ((feedback & 0x7) << 3) | (algo & 0x7);
-  ym_write(0, 0xB0, val);
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    ym_set_fb_algo(ch, val);
+  }
   YM2612_latchDacDataReg();
   Z80_releaseBus();    
+
+  ymvoice_set_legato(ym_legato, algo); // the carriers depend on the algorithm
 }
 
 void set_ym_pan_ams_fms(uint8_t pan, uint8_t ams, uint8_t fms) {
   Z80_requestBus(1);
   uint8_t val = ((pan & 3) << 6) | ((ams & 3) << 4) | (fms & 7);
-  ym_write(0, 0xB4, val);
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    ym_write_chan(ch, 0xB4, val);
+  }
   YM2612_latchDacDataReg();
   Z80_releaseBus();    
 }
 
+// copy a bank patch into the fields, the fields hold op4 plus the per
+// operator levels and ssg-eg, the rest of the patch stays in ROM
+void load_ym_patch(uint8_t num) {
+  const ym_patch_t *patch = &ym_patches[num - 1];
+  const uint8_t *op4 = patch->op[3];
+
+  ym_feedback = (patch->fbAlgo >> 3) & 7;
+  ym_algo = patch->fbAlgo & 7;
+  ym_ams = (patch->amsFms >> 4) & 3;
+  ym_fms = patch->amsFms & 7;
+  ym_detune = (op4[0] >> 4) & 7;
+  ym_mult = op4[0] & 0x0F;
+  ym_attack = op4[2] & 0x1F;
+  ym_decay = op4[3] & 0x1F;
+  ym_am = op4[3] >> 7;
+  ym_sustain = op4[5] >> 4;
+  ym_release = op4[5] & 0x0F;
+
+  for (uint8_t channel=0; channel<YM_CHAN_COUNT; channel++) {
+    for (uint8_t operator=0; operator<YM_OP_COUNT; operator++) {
+      int index = channel * 4 + operator;
+      uint8_t ssgeg = patch->op[operator][6];
+      ym_level[index] = patch->op[operator][1];
+      ym_ssgeg[index] = (ssgeg & 0x08) ? (ssgeg & 0x07) + 1 : 0;
+    }
+  }
+}
+
+// send the whole instrument to the chip
+void ym_apply_instrument() {
+  if (ym_patch) {
+    // the patch sets every operator, the fields below then override op4
+    Z80_requestBus(1);
+    for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+      if (!ymvoice_uses(ch)) continue;
+      ym_write_patch(ch, &ym_patches[ym_patch - 1]);
+    }
+    YM2612_latchDacDataReg();
+    Z80_releaseBus();
+  }
+
+  set_ym_lfo(ym_lfo_enable, ym_lfo_speed);
+  set_ym_detune_mult(ym_detune, ym_mult);
+
+  for (uint8_t channel=0; channel<YM_CHAN_COUNT; channel++) {
+    for (uint8_t operator=0; operator<YM_OP_COUNT; operator++) {
+      int index = channel * 4 + operator;
+      set_ym_level(channel, operator, ym_level[index]);
+      set_ym_ssgeg(channel, operator, ym_ssgeg[index]);
+    }
+  }
+
+  set_ym_attack(ym_attack);
+  set_ym_release_sustain(ym_release, ym_sustain);
+  set_ym_decay_am(ym_decay, ym_am);
+  set_ym_feedback_algo(ym_feedback, ym_algo);
+  set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+  ymvoice_set_pitch_mod(ym_glide, ym_vib_speed, ym_vib_depth, ym_bend);
+  ymvoice_set_macros(ym_arp, ym_pitch_macro);
+}
+
+// switch channel 3 between a chord voice and four independent operator voices
+void set_ym_ch3_mode(uint8_t special) {
+  Z80_requestBus(1);
+  ymvoice_release_all();
+  ym_key_flush();
+  ym3KeyMask = 0;
+  ym_key_ops(2, ym3KeyMask);
+  ymvoice_init(special ? YM_VOICES_NO_CH3 : YM_VOICES_ALL);
+  ym_set_ch3_special(special);
+
+  if (special) {
+    ym_set_fb_algo(2, YM3_FB_ALGO); // Algorithm 7, every operator is a carrier, no feedback
+    for (uint8_t op = 0; op < YM3_OP_COUNT; op++) {
+      ym_write_op(2, op, 0x30, 0x01); // plain sine, multiplier 1
+      ym_write_op(2, op, 0x50, 0x1F); // instant attack
+      ym_write_op(2, op, 0x60, 0x0C); // decay towards silence for a percussive blip
+      ym_write_op(2, op, 0x70, 0x00);
+      ym_write_op(2, op, 0x80, 0xFF); // sustain level at the bottom, fast release
+    }
+  }
+  YM2612_latchDacDataReg();
+  Z80_releaseBus();
+
+  // the setters skip channel 3 while it is special, but its operator levels
+  // still come from the instrument and set the volume of the four voices
+  ym_apply_instrument();
+}
+
+// pick the sequencer clock, timer A runs only while it is the clock
+void set_seq_clock(uint8_t clock) {
+  Z80_requestBus(1);
+  if (clock == SEQ_CLOCK_TIMER_A) {
+    ym_timer_a_start(timer_a_value);
+  } else {
+    ym_timer_a_stop();
+  }
+  YM2612_latchDacDataReg();
+  Z80_releaseBus();
+  timerCounting = timer_a_value;
+  clockAcc = 0;
+  stepTicks = 0;
+  timerJitter = 0;
+}
+
+// a timer A value edit while it is the clock, the clock state carries on
+void set_timer_a_period() {
+  Z80_requestBus(1);
+  ym_timer_a_period(timer_a_value);
+  YM2612_latchDacDataReg();
+  Z80_releaseBus();
+}
+
 /* savegame stuff */
 // Define key SRAM memory addresses as volatile pointers
 // Volatile is crucial as the hardware might change values outside the C program's control
@@ -337,13 +906,14 @@ void set_ym_pan_ams_fms(uint8_t pan, uint8_t ams, uint8_t fms) {
 typedef struct {
   uint16_t magic;
 
-  uint8_t tempo;
+  uint16_t bpm;
   uint8_t ym_attack;
   uint8_t ym_lfo_enable;
   uint8_t ym_lfo_speed;
   uint8_t ym_detune;
   uint8_t ym_mult;
   uint8_t ym_level[YM_OP_CHAN_COUNT];
+  uint8_t ym_ssgeg[YM_OP_CHAN_COUNT];
   uint8_t ym_release;
   uint8_t ym_sustain;
   uint8_t ym_decay;
@@ -353,12 +923,37 @@ typedef struct {
   uint8_t ym_pan;
   uint8_t ym_ams;
   uint8_t ym_fms;
+  uint8_t ym_glide;
+  uint8_t ym_vib_speed;
+  uint8_t ym_vib_depth;
+  int8_t ym_bend;
+  uint8_t ym_patch;
+  uint8_t ym_legato;
+  uint8_t ym_arp;
+  uint8_t ym_pitch_macro;
+  uint8_t ym_ch3_special;
+  uint8_t seq_clock;
+  uint16_t timer_a_value;
   
-  uint8_t sequence[16];
-  uint8_t accent[16];
-  uint8_t speed[16];
-  uint8_t psgnote[16];
-  int8_t ymNoteCh0[16];
+  uint8_t song_mode;
+  uint8_t song_length;
+  uint8_t swing;
+  uint8_t groove;
+  uint8_t rec_trim;
+  uint8_t song[SONG_LENGTH_MAX][TRACK_COUNT];
+  uint8_t edit_pattern[TRACK_COUNT];
+  uint8_t pattern_length[TRACK_COUNT][PATTERN_COUNT];
+  uint8_t pattern_rate[TRACK_COUNT][PATTERN_COUNT];
+  // only the patterns with a block are saved, packed in pattern order. the
+  // maps give the saved block of each pattern + 1, 0 for a blank one
+  uint8_t step_map[TRACK_COUNT][PATTERN_COUNT];
+  uint8_t lock_map[TRACK_COUNT][PATTERN_COUNT];
+  pcm_step_t pcm[PCM_BLOCKS][PATTERN_STEPS_MAX];
+  psg_step_t psg[PSG_BLOCKS][PATTERN_STEPS_MAX];
+  ym_step_t ym[YM_BLOCKS][PATTERN_STEPS_MAX];
+  ym3_step_t ym3[YM3_BLOCKS][PATTERN_STEPS_MAX];
+  plock_list_t plocks[LOCK_BLOCKS];
+  psgenv_shape_t psgenv[PSG_TRACK_COUNT];
   
   uint8_t  checksum;      // Simple checksum for data integrity - (ignored here)
   uint8_t  padding;       // Padding to ensure alignment if needed, although 8-bit access is standard
@@ -373,6 +968,121 @@ uint8_t calculate_checksum(const GameSaveData* data);
 void unlock_sram(void);
 void lock_sram(void);
 
+// hand back the blocks of patterns that went blank again and of empty lock
+// lists, so the save and the pools only hold patterns with something in
+// them. the edited patterns keep theirs, and so does anything the rows
+// playing point at
+static void patterns_compact() {
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+      void *steps = patternSteps[t][p];
+      plock_list_t *list = patternLocks[t][p];
+
+      if (steps != blankSteps[t] && p != editPattern[t] &&
+	  !memcmp(steps, blankSteps[t], PATTERN_BYTES(t))) {
+	disable_ints; // the vblank handler looks rows up
+	if (steps != playRow.pcm && steps != playRow.psg && steps != playRow.ym && steps != playRow.ym3 &&
+	    steps != nextRow.pcm && steps != nextRow.psg && steps != nextRow.ym && steps != nextRow.ym3) {
+	  patternSteps[t][p] = blankSteps[t];
+	  pool_free(&stepPools[t], steps);
+	}
+	enable_ints;
+      }
+      if (list != &noLocks && !list->count) {
+	disable_ints;
+	if (list != playRow.locks[t] && list != nextRow.locks[t]) {
+	  patternLocks[t][p] = &noLocks;
+	  pool_free(&lockPool, list);
+	}
+	enable_ints;
+      }
+    }
+  }
+}
+
+// the song and every pattern with a block, to and from the save data
+void patterns_to_save(GameSaveData *data) {
+  void *blocks[TRACK_COUNT] = {data->pcm, data->psg, data->ym, data->ym3};
+  uint8_t locks = 0;
+
+  patterns_compact();
+  data->song_mode = songMode;
+  data->song_length = songLength;
+  data->swing = seq_swing;
+  data->groove = seq_groove;
+  data->rec_trim = recTrim;
+  memcpy(data->song, song, sizeof(song));
+  memcpy(data->edit_pattern, editPattern, sizeof(editPattern));
+  memcpy(data->pattern_length, patternLength, sizeof(patternLength));
+  memcpy(data->pattern_rate, patternRate, sizeof(patternRate));
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    uint8_t used = 0;
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+      data->step_map[t][p] = 0;
+      if (patternSteps[t][p] != blankSteps[t]) {
+	memcpy((uint8_t *)blocks[t] + used * PATTERN_BYTES(t), patternSteps[t][p], PATTERN_BYTES(t));
+	data->step_map[t][p] = ++used;
+      }
+      data->lock_map[t][p] = 0;
+      if (patternLocks[t][p] != &noLocks) {
+	data->plocks[locks] = *patternLocks[t][p];
+	data->lock_map[t][p] = ++locks;
+      }
+    }
+  }
+}
+
+// anything out of range falls back to the first pattern and the default length
+void patterns_from_save(const GameSaveData *data) {
+  songMode = data->song_mode ? 1 : 0;
+  songLength = (data->song_length >= 1 && data->song_length <= SONG_LENGTH_MAX) ? data->song_length : 1;
+  seq_swing = data->swing <= SWING_MAX ? data->swing : 0;
+  seq_groove = data->groove < GROOVE_COUNT ? data->groove : 0;
+  recTrim = data->rec_trim <= REC_TRIM_MAX ? data->rec_trim : 0;
+  for (int row=0; row<SONG_LENGTH_MAX; row++) {
+    for (int t=0; t<TRACK_COUNT; t++) {
+      song[row][t] = data->song[row][t] < PATTERN_COUNT ? data->song[row][t] : 0;
+    }
+  }
+  for (int t=0; t<TRACK_COUNT; t++) {
+    editPattern[t] = data->edit_pattern[t] < PATTERN_COUNT ? data->edit_pattern[t] : 0;
+    for (int p=0; p<PATTERN_COUNT; p++) {
+      uint8_t length = data->pattern_length[t][p];
+      patternLength[t][p] = (length >= 1 && length <= PATTERN_STEPS_MAX) ? length : PATTERN_LENGTH_DEFAULT;
+      patternRate[t][p] = data->pattern_rate[t][p] < RATE_COUNT ? data->pattern_rate[t][p] : RATE_DEFAULT;
+    }
+  }
+
+  // claimed in pattern order, so the pools come out packed like the save
+  const void *blocks[TRACK_COUNT] = {data->pcm, data->psg, data->ym, data->ym3};
+  patterns_release();
+  for (int t=0; t<TRACK_COUNT; t++) {
+    for (int p=0; p<PATTERN_COUNT; p++) {
+      uint8_t block = data->step_map[t][p];
+      uint8_t locks = data->lock_map[t][p];
+      if (block && block <= trackBlocks[t] && pattern_claim(t, p)) {
+	memcpy(patternSteps[t][p], (const uint8_t *)blocks[t] + (block - 1) * PATTERN_BYTES(t), PATTERN_BYTES(t));
+      }
+      if (locks && locks <= LOCK_BLOCKS && locks_claim(t, p)) {
+	plock_list_t *list = patternLocks[t][p];
+	*list = data->plocks[locks - 1];
+	if (list->count > PLOCK_MAX) plock_clear(list);
+	for (int i=0; i<list->count; i++) {
+	  if (list->lock[i].param >= PLOCK_PARAM_COUNT) plock_clear(list);
+	}
+      }
+    }
+  }
+  patterns_compile(); // never trust compiled bytes from an older build
+  if (!bind_edit_patterns()) {
+    // only if the save was cut short, the first patterns always fit
+    for (int t=0; t<TRACK_COUNT; t++) {
+      editPattern[t] = 0;
+    }
+    bind_edit_patterns();
+  }
+}
+
 void unlock_sram(void) {
     // Write 1 to the SRAM lock address to enable writing
     *SRAM_LOCK_ADDR = 1;
@@ -436,14 +1146,14 @@ uint8_t load_game_from_sram(GameSaveData* data) {
     // enable_interrupts(); // Re-enable interrupts
 
     // Verify data integrity using the magic number and checksum
-    if (data->magic != 0xABCE) { // Check if the save data has been initialized
-	vdp_text_clear(VDP_PLAN_A, 3, 18, 40);
-	vdp_puts(VDP_PLAN_A, "incorrect magic", 3, 18);
+    if (data->magic != 0xABE1) { // Check if the save data has been initialized
+	vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+	vdp_puts(VDP_PLAN_A, "incorrect magic", 3, STATUS_ROW);
         return 0; 
     }
     if (data->checksum != calculate_checksum(data)) { // Check if data is corrupted
-	vdp_text_clear(VDP_PLAN_A, 3, 18, 40);
-	vdp_puts(VDP_PLAN_A, "checksum mismatch", 3, 18);
+	vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+	vdp_puts(VDP_PLAN_A, "checksum mismatch", 3, STATUS_ROW);
 //        return 0;
 	return 1;
     }
@@ -457,15 +1167,16 @@ void savegame_init(void) {
     if (load_game_from_sram(&mySave)) {
         // Data loaded successfully, continue game
         // ... use mySave.player_score, etc.
-      tempo = mySave.tempo;
+      bpm = (mySave.bpm >= BPM_MIN && mySave.bpm <= BPM_MAX) ? mySave.bpm : 1200;
       ym_attack = mySave.ym_attack;
       ym_lfo_enable = mySave.ym_lfo_enable;
       ym_lfo_speed = mySave.ym_lfo_speed;
       ym_detune = mySave.ym_detune;
       ym_mult = mySave.ym_mult;
 
-      for (int i=0; i<12; i++) {
+      for (int i=0; i<YM_OP_CHAN_COUNT; i++) {
 	ym_level[i] = mySave.ym_level[i];
+	ym_ssgeg[i] = mySave.ym_ssgeg[i] <= YM_SSGEG_MAX ? mySave.ym_ssgeg[i] : 0;
       }
       
       ym_release = mySave.ym_release;
@@ -477,39 +1188,35 @@ void savegame_init(void) {
       ym_pan = mySave.ym_pan;
       ym_ams = mySave.ym_ams;
       ym_fms = mySave.ym_fms;
-      
-      for (int i=0; i<16; i++) {
-	gateseq[i] = mySave.sequence[i];
-	accseq[i] = mySave.accent[i];
-	speedseq[i] = mySave.speed[i];
-	psgNoteSeq[i] = mySave.psgnote[i];
-	ymNoteSeq[i] = mySave.ymNoteCh0[i];
+      ym_glide = mySave.ym_glide;
+      ym_vib_speed = mySave.ym_vib_speed;
+      ym_vib_depth = mySave.ym_vib_depth;
+      ym_bend = mySave.ym_bend;
+      ym_patch = mySave.ym_patch <= YM_PATCH_COUNT ? mySave.ym_patch : 0;
+      ym_legato = mySave.ym_legato;
+      ym_arp = mySave.ym_arp < MACRO_BANK_SIZE ? mySave.ym_arp : 0;
+      ym_pitch_macro = mySave.ym_pitch_macro < MACRO_BANK_SIZE ? mySave.ym_pitch_macro : 0;
+      ym_ch3_special = mySave.ym_ch3_special;
+      seq_clock = mySave.seq_clock;
+      timer_a_value = mySave.timer_a_value & 0x3FF;
+
+      for (int t=0; t<PSG_TRACK_COUNT; t++) {
+	psgenv_shapes[t] = mySave.psgenv[t];
       }
+      
+      patterns_from_save(&mySave);
 
       // send the saved settings to the ym chip
-      set_ym_lfo(ym_lfo_enable, ym_lfo_speed);
-      set_ym_detune_mult(ym_detune, ym_mult);
-
-      for (uint8_t channel=0; channel<YM_CHAN_COUNT; channel++) {
-	for (uint8_t operator=0; operator<YM_OP_COUNT; operator++) {
-	  int index = channel * 4 + operator;
-	  set_ym_level(channel, operator, ym_level[index]);
-	}
-      }
+      set_ym_ch3_mode(ym_ch3_special); // also applies the instrument
+      set_seq_clock(seq_clock);
       
-      set_ym_attack(ym_attack);
-      set_ym_release_sustain(ym_release, ym_sustain);
-      set_ym_decay_am(ym_decay, ym_am);
-      set_ym_feedback_algo(ym_feedback, ym_algo);
-      set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
-      
-      vdp_text_clear(VDP_PLAN_A, 3, 18, 40);
-      vdp_puts(VDP_PLAN_A, "saved sequence loaded", 3, 18);
+      vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+      vdp_puts(VDP_PLAN_A, "saved sequence loaded", 3, STATUS_ROW);
     } else {
         // No valid save data found, start a new game and initialize structure
-        mySave.magic = 0xABCE; // Set magic number
+        mySave.magic = 0xABE1; // Set magic number
 
-	mySave.tempo = tempo;
+	mySave.bpm = bpm;
 	mySave.ym_attack = ym_attack;
 	mySave.ym_lfo_enable = ym_lfo_enable;
 	mySave.ym_lfo_speed = ym_lfo_speed;
@@ -520,6 +1227,7 @@ void savegame_init(void) {
 	  for (uint8_t operator=0; operator<YM_OP_COUNT; operator++) {
 	    int index = channel * 4 + operator;
 	    mySave.ym_level[index] = ym_level[index];
+	    mySave.ym_ssgeg[index] = ym_ssgeg[index];
 	  }
 	}
 
@@ -532,15 +1240,24 @@ void savegame_init(void) {
 	mySave.ym_pan = ym_pan;
 	mySave.ym_ams = ym_ams;
 	mySave.ym_fms = ym_fms;
-	
-	for (int i=0; i<16; i++) {
-	  mySave.sequence[i] = gateseq[i];
-	  mySave.sequence[i] = accseq[i];
-	  mySave.speed[i] = speedseq[i];
-	  mySave.psgnote[i] = psgNoteSeq[i];
-	  mySave.ymNoteCh0[i] = ymNoteSeq[i];	  
+	mySave.ym_glide = ym_glide;
+	mySave.ym_vib_speed = ym_vib_speed;
+	mySave.ym_vib_depth = ym_vib_depth;
+	mySave.ym_bend = ym_bend;
+	mySave.ym_patch = ym_patch;
+	mySave.ym_legato = ym_legato;
+	mySave.ym_arp = ym_arp;
+	mySave.ym_pitch_macro = ym_pitch_macro;
+	mySave.ym_ch3_special = ym_ch3_special;
+	mySave.seq_clock = seq_clock;
+	mySave.timer_a_value = timer_a_value;
+
+	for (int t=0; t<PSG_TRACK_COUNT; t++) {
+	  mySave.psgenv[t] = psgenv_shapes[t];
 	}
 	
+	patterns_to_save(&mySave);
+	
         // Calculate and set initial checksum
         mySave.checksum = calculate_checksum(&mySave); 
         // Save the initial data to SRAM immediately
@@ -548,9 +1265,17 @@ void savegame_init(void) {
     }
 }
 
+// edits only mark the save as pending, writing all of it to sram on every
+// keypress took longer than a frame. it goes out once the edits stop for
+// SAVE_IDLE_FRAMES frames, or when playback stops
 void savegame() {
+  saveIdle = SAVE_IDLE_FRAMES;
+}
 
-  mySave.tempo = tempo;
+void savegame_write() {
+  saveIdle = 0;
+
+  mySave.bpm = bpm;
   mySave.ym_attack = ym_attack;
   mySave.ym_lfo_enable = ym_lfo_enable;
   mySave.ym_lfo_speed = ym_lfo_speed;
@@ -561,6 +1286,7 @@ void savegame() {
     for (uint8_t operator=0; operator<YM_OP_COUNT; operator++) {
       int index = channel * 4 + operator;
       mySave.ym_level[index] = ym_level[index];
+      mySave.ym_ssgeg[index] = ym_ssgeg[index];
     }
   }
   
@@ -573,26 +1299,28 @@ void savegame() {
   mySave.ym_pan = ym_pan;
   mySave.ym_ams = ym_ams;
   mySave.ym_fms = ym_fms;
-
-  for (int i=0; i<16; i++) {
-    mySave.sequence[i] = gateseq[i];
-    mySave.accent[i] = accseq[i];
-    mySave.speed[i] = speedseq[i];
-    mySave.psgnote[i] = psgNoteSeq[i];
-    mySave.ymNoteCh0[i] = ymNoteSeq[i];    
+  mySave.ym_glide = ym_glide;
+  mySave.ym_vib_speed = ym_vib_speed;
+  mySave.ym_vib_depth = ym_vib_depth;
+  mySave.ym_bend = ym_bend;
+  mySave.ym_patch = ym_patch;
+  mySave.ym_legato = ym_legato;
+  mySave.ym_arp = ym_arp;
+  mySave.ym_pitch_macro = ym_pitch_macro;
+  mySave.ym_ch3_special = ym_ch3_special;
+  mySave.seq_clock = seq_clock;
+  mySave.timer_a_value = timer_a_value;
+
+  for (int t=0; t<PSG_TRACK_COUNT; t++) {
+    mySave.psgenv[t] = psgenv_shapes[t];
   }
+
+  patterns_to_save(&mySave);
   
   mySave.checksum = calculate_checksum(&mySave); // Update checksum before saving
   save_game_to_sram(&mySave);
-  vdp_text_clear(VDP_PLAN_A, 3, 18, 40);
-  vdp_puts(VDP_PLAN_A, "sequence saved", 3, 18);
-}
-
-void play_sample() {
-  Z80_requestBus(1);
-  Z80_write(playCommand_addr, 1);
-  Z80_releaseBus();
-
+  vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+  vdp_puts(VDP_PLAN_A, "sequence saved", 3, STATUS_ROW);
 }
 
 void stop_sample() {
@@ -602,35 +1330,51 @@ void stop_sample() {
   Z80_releaseBus();  
 }
 
-void set_sample_length(uint16_t length) {
-  Z80_requestBus(1);
-  Z80_write(sampleLength_addr, length & 0x00FF);
-  Z80_write(sampleLength_addr+1, length >> 8);
-  Z80_releaseBus();  
+void psg_silence() {
+  psgenv_init(); // straight to silent, no release
 }
 
-void set_sample_start(uint16_t length) {
-  Z80_requestBus(1);
-  Z80_write(sampleStart_addr, length & 0x00FF);
-  Z80_write(sampleStart_addr+1, length >> 8);
-  Z80_releaseBus();  
+// the lane under a psg screen column, note and volume lanes alternate
+int8_t *psg_lane(int step, int col) {
+  return (col & 1) ? &psgSeq[step].vol[col >> 1] : &psgSeq[step].note[col >> 1];
 }
 
-void set_accent(int accent) {
-  Z80_requestBus(1);
-  if (accent) {
-    Z80_write(accent_addr, 1);
-  } else {
-    Z80_write(accent_addr, 0);
-  }
+// queue an edit for the vblank handler, the values themselves are read from
+// the globals when it runs. only waits if the handler is a whole queue behind
+void sound_post(uint8_t cmd, uint8_t arg) {
+  uint8_t next = (soundHead + 1) & (SOUND_QUEUE_SIZE - 1);
 
-  Z80_releaseBus();  
+  while (next == soundTail) {};
+  soundQueue[soundHead] = cmd | (arg << 8);
+  soundHead = next;
+}
+
+// start button: cut every sound now, release tails included, then put the
+// instrument back on the freshly reset chip
+void panic() {
+  sound_post(SOUND_PANIC, 0);
+  if (saveIdle) savegame_write();
+
+  vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+  vdp_puts(VDP_PLAN_A, "all notes off", 3, STATUS_ROW);
 }
 
-void set_dacSpeed(uint8_t speed) {
+// everything a pcm step sends to the z80 driver under one bus request. a
+// sample still playing is stopped, the driver then finds the play command
+// set again and starts the new one
+void pcm_trigger(const pcm_step_t *step, uint8_t speed) {
+  const sample_entry_t *entry = &sampleDir[step->sample];
+
   Z80_requestBus(1);
+  if (Z80_read(playCommand_addr)) Z80_write(stopCommand_addr, 1);
+  Z80_write(accent_addr, step->flags & PCM_STEP_ACCENT);
+  Z80_write(sampleStart_addr, entry->start & 0x00FF);
+  Z80_write(sampleStart_addr+1, entry->start >> 8);
+  Z80_write(sampleLength_addr, entry->length & 0x00FF);
+  Z80_write(sampleLength_addr+1, entry->length >> 8);
   Z80_write(speed_addr, speed);
-  Z80_releaseBus();  
+  Z80_write(playCommand_addr, 1);
+  Z80_releaseBus();
 }
 
 void set_kit_bank() {
@@ -650,10 +1394,11 @@ int rightpressed = 0;
 int leftpressed = 0;
 int apressed = 0;
 int bpressed = 0;
+int startpressed = 0;
 int cpressed = 0;
 
 int frame = 0;
-int laststep = 0;
+int laststep = -1; // row of the play cursor, -1 when it isn't shown
 int selectstep = 0;
 int lastselectstep = 0;
 
@@ -663,69 +1408,133 @@ void clearScreen() {
   }
 }
 
+// move the edit cursor between columns, columns are 3 tiles apart starting at x 5
+void moveColumnCursor(int oldcol, int newcol, int step) {
+  vdp_text_clear(VDP_PLAN_A, 5 + oldcol * 3, step, 1);
+  vdp_text_clear(VDP_PLAN_A, 8 + oldcol * 3, step, 1);
+  vdp_puts(VDP_PLAN_A, ">", 5 + newcol * 3, step);
+  vdp_puts(VDP_PLAN_A, "<", 8 + newcol * 3, step);
+}
+
+int shownPage = -1; // first step of the page last drawn
+
+// the track a sequencer screen edits, -1 for the song screen
+int screen_track() {
+  if (screen == SCREEN_PCM_SEQ) return TRACK_PCM;
+  if (screen == SCREEN_PSG_SEQ) return TRACK_PSG;
+  if (screen == SCREEN_YM_SEQ) return TRACK_YM;
+  if (screen == SCREEN_YM3_SEQ) return TRACK_YM3;
+  return -1;
+}
+
+// steps the cursor moves through: the edited pattern, or the song rows
+int screen_steps() {
+  int track = screen_track();
+
+  return track < 0 ? songLength : patternLength[track][editPattern[track]];
+}
+
+// step numbers for the page holding selectstep and the page readout under
+// the title, returns how many steps the page shows
+int drawStepPage(int track) {
+  int length = screen_steps();
+  int first;
+
+  if (selectstep >= length) selectstep = length - 1;
+  first = PAGE_FIRST(selectstep);
+  shownPage = first;
+  laststep = -1; // the play cursor is drawn again
+
+  for (int row = 0; row < PAGE_STEPS && first + row < length; row++) {
+    sprintf(s, "%02d", first + row);
+    vdp_puts(VDP_PLAN_A, s, 3, row);
+  }
+  if (track >= 0) {
+    sprintf(s, "pat %02d", editPattern[track]);
+    vdp_puts(VDP_PLAN_A, s, SCREEN_TILEW - 8, 1);
+  }
+  sprintf(s, "pg %d/%d", first / PAGE_STEPS + 1, (length + PAGE_STEPS - 1) / PAGE_STEPS);
+  vdp_puts(VDP_PLAN_A, s, SCREEN_TILEW - 8, 3);
+
+  return length - first < PAGE_STEPS ? length - first : PAGE_STEPS;
+}
+
+// the play cursor, shown while the pattern or song row on screen is playing
+void updatePlayCursor(int track) {
+  int pos, shown;
+  int row = -1;
+
+  disable_ints; // position and row from the same tick
+  pos = track < 0 ? songpos : trackPos[track];
+  shown = track < 0 ? songMode : playRow.pattern[track] == editPattern[track];
+  enable_ints;
+
+  if (playing && shown && PAGE_FIRST(pos) == shownPage) row = STEP_ROW(pos);
+  if (row != laststep) {
+    if (laststep >= 0) vdp_text_clear(VDP_PLAN_A, 0, laststep, 3);
+    if (row >= 0) vdp_puts(VDP_PLAN_A, "-->", 0, row);
+    laststep = row;
+  }
+}
+
 void displayPCMScreen() {
 
-  // stuff to do when the screen just changed to PCM
-  if (screen != oldscreen) {
+  // stuff to do when the screen just changed to PCM, or to another page
+  if (screen != oldscreen || PAGE_FIRST(selectstep) != shownPage) {
 
     clearScreen();
 
     vdp_puts(VDP_PLAN_A, "PCM SEQ", SCREEN_TILEW - 8, 0);    
     
     // print the step number column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02d", step);
-      vdp_puts(VDP_PLAN_A, s, 3, step);
-    }
+    int rows = drawStepPage(TRACK_PCM);
+    int first = PAGE_FIRST(selectstep);
 
     // print the sample number column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02d", gateseq[step]);
+    for (int step = 0; step < rows; step++) {
+      sprintf(s, "%02d", pcmSeq[first + step].sample);
       vdp_puts(VDP_PLAN_A, s, 6, step);
     }  
 
     // print the accent column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02d", accseq[step]);
+    for (int step = 0; step < rows; step++) {
+      sprintf(s, "%02d", pcmSeq[first + step].flags & PCM_STEP_ACCENT);
       vdp_puts(VDP_PLAN_A, s, 9, step);
     }  
 
     // print the speed column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02X", speedseq[step]);
+    for (int step = 0; step < rows; step++) {
+      sprintf(s, "%02X", pcmSeq[first + step].speed);
       vdp_puts(VDP_PLAN_A, s, 12, step);
     }  
 
     // print the cursors
-    vdp_puts(VDP_PLAN_A, "-->", 0, seqpos);
-    vdp_puts(VDP_PLAN_A, ">", 5, selectstep);
-    vdp_puts(VDP_PLAN_A, "<", 8, selectstep);    
+    if (column >= COLUMN_COUNT) column = 0;
+    oldcolumn = column;
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));    
   }
 
   // update the cursors
-  if (seqpos != laststep) {
-      vdp_text_clear(VDP_PLAN_A, 0, laststep, 3);
-      vdp_puts(VDP_PLAN_A, "-->", 0, seqpos);      
-      laststep = seqpos;
-    }
+  updatePlayCursor(TRACK_PCM);
 
     // update the values displayed
     if (selectstep != lastselectstep) {
       if (column == 0) {
-	vdp_text_clear(VDP_PLAN_A, 5, lastselectstep, 1);
-	vdp_text_clear(VDP_PLAN_A, 8, lastselectstep, 1);      
-	vdp_puts(VDP_PLAN_A, ">", 5, selectstep);
-	vdp_puts(VDP_PLAN_A, "<", 8, selectstep);            
+	vdp_text_clear(VDP_PLAN_A, 5, STEP_ROW(lastselectstep), 1);
+	vdp_text_clear(VDP_PLAN_A, 8, STEP_ROW(lastselectstep), 1);      
+	vdp_puts(VDP_PLAN_A, ">", 5, STEP_ROW(selectstep));
+	vdp_puts(VDP_PLAN_A, "<", 8, STEP_ROW(selectstep));            
       } else if (column == 1) {
-	vdp_text_clear(VDP_PLAN_A, 8, lastselectstep, 1);
-	vdp_text_clear(VDP_PLAN_A, 11, lastselectstep, 1);      
-	vdp_puts(VDP_PLAN_A, ">", 8, selectstep);
-	vdp_puts(VDP_PLAN_A, "<", 11, selectstep);            
+	vdp_text_clear(VDP_PLAN_A, 8, STEP_ROW(lastselectstep), 1);
+	vdp_text_clear(VDP_PLAN_A, 11, STEP_ROW(lastselectstep), 1);      
+	vdp_puts(VDP_PLAN_A, ">", 8, STEP_ROW(selectstep));
+	vdp_puts(VDP_PLAN_A, "<", 11, STEP_ROW(selectstep));            
       } else if (column == 2) {
-	vdp_text_clear(VDP_PLAN_A, 11, lastselectstep, 1);
-	vdp_text_clear(VDP_PLAN_A, 14, lastselectstep, 1);      
-	vdp_puts(VDP_PLAN_A, ">", 11, selectstep);
-	vdp_puts(VDP_PLAN_A, "<", 14, selectstep);            
+	vdp_text_clear(VDP_PLAN_A, 11, STEP_ROW(lastselectstep), 1);
+	vdp_text_clear(VDP_PLAN_A, 14, STEP_ROW(lastselectstep), 1);      
+	vdp_puts(VDP_PLAN_A, ">", 11, STEP_ROW(selectstep));
+	vdp_puts(VDP_PLAN_A, "<", 14, STEP_ROW(selectstep));            
       }
       lastselectstep = selectstep;
     }
@@ -733,110 +1542,189 @@ void displayPCMScreen() {
 
 void displayPSGScreen() {
 
-  if (screen != oldscreen) {
+  if (screen != oldscreen || PAGE_FIRST(selectstep) != shownPage) {
     clearScreen();
     vdp_puts(VDP_PLAN_A, "PSG SEQ", SCREEN_TILEW - 8, 0);
 
     // print the step number column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02d", step);
-      vdp_puts(VDP_PLAN_A, s, 3, step);
+    int rows = drawStepPage(TRACK_PSG);
+    int first = PAGE_FIRST(selectstep);
+
+    // print the note and volume columns of every track
+    for (int step = 0; step < rows; step++) {
+      for (int col = 0; col < PSG_COLUMN_COUNT; col++) {
+	sprintf(s, "%02d", *psg_lane(first + step, col));
+	vdp_puts(VDP_PLAN_A, s, 6 + col * 3, step);
+      }
     }
-
-    // print the note number column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02d", psgNoteSeq[step]);
-      vdp_puts(VDP_PLAN_A, s, 6, step);
-    }      
+    vdp_puts(VDP_PLAN_A, "t1 v1 t2 v2 t3 v3 nz nv", 6, 16);
 
     // print the cursors
-    vdp_puts(VDP_PLAN_A, "-->", 0, seqpos);
-    vdp_puts(VDP_PLAN_A, ">", 5, selectstep);
-    vdp_puts(VDP_PLAN_A, "<", 8, selectstep);    
+    if (column >= PSG_COLUMN_COUNT) column = 0;
+    oldcolumn = column;
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));    
 
   }
 
   // update the cursors
-  if (seqpos != laststep) {
-      vdp_text_clear(VDP_PLAN_A, 0, laststep, 3);
-      vdp_puts(VDP_PLAN_A, "-->", 0, seqpos);      
-      laststep = seqpos;
-  }
+  updatePlayCursor(TRACK_PSG);
 
     // update the values displayed
     if (selectstep != lastselectstep) {
-      vdp_text_clear(VDP_PLAN_A, 5, lastselectstep, 1);
-      vdp_text_clear(VDP_PLAN_A, 8, lastselectstep, 1);      
-      vdp_puts(VDP_PLAN_A, ">", 5, selectstep);
-      vdp_puts(VDP_PLAN_A, "<", 8, selectstep);            
+      vdp_text_clear(VDP_PLAN_A, 5 + column * 3, STEP_ROW(lastselectstep), 1);
+      vdp_text_clear(VDP_PLAN_A, 8 + column * 3, STEP_ROW(lastselectstep), 1);      
+      vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+      vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));            
       lastselectstep = selectstep;
     }  
 }
 
 void displayYMScreen() {
 
-  if (screen != oldscreen) {
+  if (screen != oldscreen || PAGE_FIRST(selectstep) != shownPage) {
 
     clearScreen();
     vdp_puts(VDP_PLAN_A, "YM SEQ ", SCREEN_TILEW - 8, 0);
 
     // print the step number column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02d", step);
-      vdp_puts(VDP_PLAN_A, s, 3, step);
-    }
-
-    // print the note number column
-    for (int step = 0; step < 16; step++) {
-      sprintf(s, "%02d", ymNoteSeq[step]);
-      vdp_puts(VDP_PLAN_A, s, 6, step);
+    int rows = drawStepPage(TRACK_YM);
+    int first = PAGE_FIRST(selectstep);
+
+    // print the chord note columns
+    for (int step = 0; step < rows; step++) {
+      for (int n = 0; n < YM_CHORD_MAX; n++) {
+	sprintf(s, "%02d", ymSeq[first + step].note[n]);
+	vdp_puts(VDP_PLAN_A, s, 6 + n * 3, step);
+      }
     }      
 
     // print the cursors
-    vdp_puts(VDP_PLAN_A, "-->", 0, seqpos);
-    vdp_puts(VDP_PLAN_A, ">", 5, selectstep);
-    vdp_puts(VDP_PLAN_A, "<", 8, selectstep);    
+    if (column >= YM_CHORD_MAX) column = 0;
+    oldcolumn = column;
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));    
   }
 
   // update the cursors
-  if (seqpos != laststep) {
-      vdp_text_clear(VDP_PLAN_A, 0, laststep, 3);
-      vdp_puts(VDP_PLAN_A, "-->", 0, seqpos);      
-      laststep = seqpos;
-  }
+  updatePlayCursor(TRACK_YM);
 
   if (selectstep != lastselectstep) {
-    vdp_text_clear(VDP_PLAN_A, 5, lastselectstep, 1);
-    vdp_text_clear(VDP_PLAN_A, 8, lastselectstep, 1);      
-    vdp_puts(VDP_PLAN_A, ">", 5, selectstep);
-    vdp_puts(VDP_PLAN_A, "<", 8, selectstep);            
+    vdp_text_clear(VDP_PLAN_A, 5 + column * 3, STEP_ROW(lastselectstep), 1);
+    vdp_text_clear(VDP_PLAN_A, 8 + column * 3, STEP_ROW(lastselectstep), 1);      
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));            
     lastselectstep = selectstep;
   }  
 }
 
-void displayYMInstScreen() {
+void displayYM3Screen() {
 
-  char s[255];
-  
-  if (screen != oldscreen) {
+  if (screen != oldscreen || PAGE_FIRST(selectstep) != shownPage) {
 
     clearScreen();
-    vdp_puts(VDP_PLAN_A, "YM INST", SCREEN_TILEW - 8, 0);
+    vdp_puts(VDP_PLAN_A, "CH3 SEQ", SCREEN_TILEW - 8, 0);
 
-    vdp_puts(VDP_PLAN_A, "lfo enable:", 0, 0);
-    sprintf(s, "%03d", ym_lfo_enable);
-    vdp_puts(VDP_PLAN_A, s, 12, 0);
+    // print the step number column
+    int rows = drawStepPage(TRACK_YM3);
+    int first = PAGE_FIRST(selectstep);
+
+    // print the operator note columns
+    for (int step = 0; step < rows; step++) {
+      for (int op = 0; op < YM3_OP_COUNT; op++) {
+	sprintf(s, "%02d", ym3Seq[first + step].note[op]);
+	vdp_puts(VDP_PLAN_A, s, 6 + op * 3, step);
+      }
+    }
 
-    vdp_puts(VDP_PLAN_A, "lfo speed :", 0, 1);
-    sprintf(s, "%03d", ym_lfo_speed);
-    vdp_puts(VDP_PLAN_A, s, 12, 1);
+    if (!ym_ch3_special) {
+      vdp_puts(VDP_PLAN_A, "ch3 mode off", SCREEN_TILEW - 13, 2);
+    }
 
-    vdp_puts(VDP_PLAN_A, "detune    :", 0, 2);
-    sprintf(s, "%03d", ym_detune);
-    vdp_puts(VDP_PLAN_A, s, 12, 2);
+    // print the cursors
+    if (column >= YM3_OP_COUNT) column = 0;
+    oldcolumn = column;
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));    
+  }
 
-    vdp_puts(VDP_PLAN_A, "mult      :", 0, 3);
-    sprintf(s, "%03d", ym_mult);
+  // update the cursors
+  updatePlayCursor(TRACK_YM3);
+
+  if (selectstep != lastselectstep) {
+    vdp_text_clear(VDP_PLAN_A, 5 + column * 3, STEP_ROW(lastselectstep), 1);
+    vdp_text_clear(VDP_PLAN_A, 8 + column * 3, STEP_ROW(lastselectstep), 1);      
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));            
+    lastselectstep = selectstep;
+  }  
+}
+
+void displaySongScreen() {
+
+  if (screen != oldscreen || PAGE_FIRST(selectstep) != shownPage) {
+
+    clearScreen();
+    vdp_puts(VDP_PLAN_A, "SONG", SCREEN_TILEW - 8, 0);
+
+    // print the row number column
+    int rows = drawStepPage(-1);
+    int first = PAGE_FIRST(selectstep);
+
+    // print the pattern of every track
+    for (int row = 0; row < rows; row++) {
+      for (int t = 0; t < TRACK_COUNT; t++) {
+	sprintf(s, "%02d", song[first + row][t]);
+	vdp_puts(VDP_PLAN_A, s, 6 + t * 3, row);
+      }
+    }
+    vdp_puts(VDP_PLAN_A, "pc ps ym c3", 6, 16);
+    if (!songMode) {
+      vdp_puts(VDP_PLAN_A, "song mode off", SCREEN_TILEW - 14, 2);
+    }
+
+    // print the cursors
+    if (column >= TRACK_COUNT) column = 0;
+    oldcolumn = column;
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));    
+  }
+
+  // update the cursors
+  updatePlayCursor(-1);
+
+  if (selectstep != lastselectstep) {
+    vdp_text_clear(VDP_PLAN_A, 5 + column * 3, STEP_ROW(lastselectstep), 1);
+    vdp_text_clear(VDP_PLAN_A, 8 + column * 3, STEP_ROW(lastselectstep), 1);      
+    vdp_puts(VDP_PLAN_A, ">", 5 + column * 3, STEP_ROW(selectstep));
+    vdp_puts(VDP_PLAN_A, "<", 8 + column * 3, STEP_ROW(selectstep));            
+    lastselectstep = selectstep;
+  }  
+}
+
+void displayYMInstScreen() {
+
+  char s[255];
+  
+  if (screen != oldscreen) {
+
+    clearScreen();
+    vdp_puts(VDP_PLAN_A, "YM INST", SCREEN_TILEW - 8, 0);
+
+    vdp_puts(VDP_PLAN_A, "lfo enable:", 0, 0);
+    sprintf(s, "%03d", ym_lfo_enable);
+    vdp_puts(VDP_PLAN_A, s, 12, 0);
+
+    vdp_puts(VDP_PLAN_A, "lfo speed :", 0, 1);
+    sprintf(s, "%03d", ym_lfo_speed);
+    vdp_puts(VDP_PLAN_A, s, 12, 1);
+
+    vdp_puts(VDP_PLAN_A, "detune    :", 0, 2);
+    sprintf(s, "%03d", ym_detune);
+    vdp_puts(VDP_PLAN_A, s, 12, 2);
+
+    vdp_puts(VDP_PLAN_A, "mult      :", 0, 3);
+    sprintf(s, "%03d", ym_mult);
     vdp_puts(VDP_PLAN_A, s, 12, 3);    
 
     vdp_puts(VDP_PLAN_A, "level     :", 0, 4);
@@ -891,6 +1779,45 @@ void displayYMInstScreen() {
     sprintf(s, "%03d", ym_chan);
     vdp_puts(VDP_PLAN_A, s, 12, 16);
 
+    vdp_puts(VDP_PLAN_A, "glide     :", 0, 17);
+    sprintf(s, "%03d", ym_glide);
+    vdp_puts(VDP_PLAN_A, s, 12, 17);
+
+    vdp_puts(VDP_PLAN_A, "vib speed :", 0, 18);
+    sprintf(s, "%03d", ym_vib_speed);
+    vdp_puts(VDP_PLAN_A, s, 12, 18);
+
+    vdp_puts(VDP_PLAN_A, "vib depth :", 0, 19);
+    sprintf(s, "%03d", ym_vib_depth);
+    vdp_puts(VDP_PLAN_A, s, 12, 19);
+
+    vdp_puts(VDP_PLAN_A, "bend      :", 0, 20);
+    sprintf(s, "%03d", ym_bend);
+    vdp_puts(VDP_PLAN_A, s, 12, 20);
+
+    vdp_puts(VDP_PLAN_A, "ssg-eg    :", 0, 21);
+    sprintf(s, "%03d", ym_ssgeg[ym_chan * 4 + ym_op]);
+    vdp_puts(VDP_PLAN_A, s, 12, 21);
+
+    vdp_puts(VDP_PLAN_A, "patch     :", 0, 22);
+    sprintf(s, "%03d", ym_patch);
+    vdp_puts(VDP_PLAN_A, s, 12, 22);
+    vdp_puts(VDP_PLAN_A, ym_patch ? ym_patches[ym_patch - 1].name : "none", 17, 22);
+
+    vdp_puts(VDP_PLAN_A, "legato    :", 0, 23);
+    sprintf(s, "%03d", ym_legato);
+    vdp_puts(VDP_PLAN_A, s, 12, 23);
+
+    vdp_puts(VDP_PLAN_A, "arp       :", 0, 24);
+    sprintf(s, "%03d", ym_arp);
+    vdp_puts(VDP_PLAN_A, s, 12, 24);
+    vdp_puts(VDP_PLAN_A, macro_name(MACRO_ARP, ym_arp), 17, 24);
+
+    vdp_puts(VDP_PLAN_A, "pitch mac :", 0, 25);
+    sprintf(s, "%03d", ym_pitch_macro);
+    vdp_puts(VDP_PLAN_A, s, 12, 25);
+    vdp_puts(VDP_PLAN_A, macro_name(MACRO_PITCH, ym_pitch_macro), 17, 25);
+
     vdp_puts(VDP_PLAN_A, ">", 11, ym_select_field);
     vdp_puts(VDP_PLAN_A, "<", 15, ym_select_field);
     
@@ -994,9 +1921,383 @@ void displayYMInstScreen() {
       vdp_puts(VDP_PLAN_A, s, 12, 16);
       ym_chan_old = ym_chan;
     }
+    if (ym_glide != ym_glide_old) {
+      sprintf(s, "%03d", ym_glide);
+      vdp_puts(VDP_PLAN_A, s, 12, 17);
+      ym_glide_old = ym_glide;
+    }
+    if (ym_vib_speed != ym_vib_speed_old) {
+      sprintf(s, "%03d", ym_vib_speed);
+      vdp_puts(VDP_PLAN_A, s, 12, 18);
+      ym_vib_speed_old = ym_vib_speed;
+    }
+    if (ym_vib_depth != ym_vib_depth_old) {
+      sprintf(s, "%03d", ym_vib_depth);
+      vdp_puts(VDP_PLAN_A, s, 12, 19);
+      ym_vib_depth_old = ym_vib_depth;
+    }
+    if (ym_bend != ym_bend_old) {
+      sprintf(s, "%03d", ym_bend);
+      vdp_puts(VDP_PLAN_A, s, 12, 20);
+      ym_bend_old = ym_bend;
+    }
+    if (ym_ssgeg[ym_chan * 4 + ym_op] != ym_ssgeg_old) {
+      sprintf(s, "%03d", ym_ssgeg[ym_chan * 4 + ym_op]);
+      vdp_puts(VDP_PLAN_A, s, 12, 21);
+      ym_ssgeg_old = ym_ssgeg[ym_chan * 4 + ym_op];
+    }
+    if (ym_patch != ym_patch_old) {
+      sprintf(s, "%03d", ym_patch);
+      vdp_puts(VDP_PLAN_A, s, 12, 22);
+      vdp_text_clear(VDP_PLAN_A, 17, 22, 8);
+      vdp_puts(VDP_PLAN_A, ym_patch ? ym_patches[ym_patch - 1].name : "none", 17, 22);
+      ym_patch_old = ym_patch;
+    }
+    if (ym_legato != ym_legato_old) {
+      sprintf(s, "%03d", ym_legato);
+      vdp_puts(VDP_PLAN_A, s, 12, 23);
+      ym_legato_old = ym_legato;
+    }
+    if (ym_arp != ym_arp_old) {
+      sprintf(s, "%03d", ym_arp);
+      vdp_puts(VDP_PLAN_A, s, 12, 24);
+      vdp_puts(VDP_PLAN_A, macro_name(MACRO_ARP, ym_arp), 17, 24);
+      ym_arp_old = ym_arp;
+    }
+    if (ym_pitch_macro != ym_pitch_macro_old) {
+      sprintf(s, "%03d", ym_pitch_macro);
+      vdp_puts(VDP_PLAN_A, s, 12, 25);
+      vdp_puts(VDP_PLAN_A, macro_name(MACRO_PITCH, ym_pitch_macro), 17, 25);
+      ym_pitch_macro_old = ym_pitch_macro;
+    }
   }
 }
 
+void displayPSGInstScreen() {
+
+  char s[255];
+  psgenv_shape_t *shape = &psgenv_shapes[psg_track];
+
+  if (screen != oldscreen) {
+
+    clearScreen();
+    vdp_puts(VDP_PLAN_A, "PSG INST", SCREEN_TILEW - 9, 0);
+
+    vdp_puts(VDP_PLAN_A, "track     :", 0, 0);
+    vdp_puts(VDP_PLAN_A, "attack    :", 0, 1);
+    vdp_puts(VDP_PLAN_A, "decay     :", 0, 2);
+    vdp_puts(VDP_PLAN_A, "sustain   :", 0, 3);
+    vdp_puts(VDP_PLAN_A, "release   :", 0, 4);
+    vdp_puts(VDP_PLAN_A, "arp       :", 0, 5);
+    vdp_puts(VDP_PLAN_A, "pitch mac :", 0, 6);
+    vdp_puts(VDP_PLAN_A, "noise mac :", 0, 7);
+    psg_track_old = 255; // values printed below
+    psg_shape_old.attack = 255;
+    psg_shape_old.decay = 255;
+    psg_shape_old.sustain = 255;
+    psg_shape_old.release = 255;
+    psg_shape_old.arp = 255;
+    psg_shape_old.pitch = 255;
+    psg_shape_old.noise = 255;
+
+    vdp_puts(VDP_PLAN_A, ">", 11, psg_select_field);
+    vdp_puts(VDP_PLAN_A, "<", 15, psg_select_field);
+    psg_select_field_old = psg_select_field;
+  }
+
+  if (psg_select_field != psg_select_field_old) {
+    vdp_puts(VDP_PLAN_A, " ", 11, psg_select_field_old);
+    vdp_puts(VDP_PLAN_A, " ", 15, psg_select_field_old);
+    vdp_puts(VDP_PLAN_A, ">", 11, psg_select_field);
+    vdp_puts(VDP_PLAN_A, "<", 15, psg_select_field);
+    psg_select_field_old = psg_select_field;
+  }
+  if (psg_track != psg_track_old) {
+    sprintf(s, "%03d", psg_track);
+    vdp_puts(VDP_PLAN_A, s, 12, 0);
+    vdp_puts(VDP_PLAN_A, psg_track == PSG_NOISE_TRACK ? "noise" : "tone ", 17, 0);
+    psg_track_old = psg_track;
+  }
+  if (shape->attack != psg_shape_old.attack) {
+    sprintf(s, "%03d", shape->attack);
+    vdp_puts(VDP_PLAN_A, s, 12, 1);
+    psg_shape_old.attack = shape->attack;
+  }
+  if (shape->decay != psg_shape_old.decay) {
+    sprintf(s, "%03d", shape->decay);
+    vdp_puts(VDP_PLAN_A, s, 12, 2);
+    psg_shape_old.decay = shape->decay;
+  }
+  if (shape->sustain != psg_shape_old.sustain) {
+    sprintf(s, "%03d", shape->sustain);
+    vdp_puts(VDP_PLAN_A, s, 12, 3);
+    psg_shape_old.sustain = shape->sustain;
+  }
+  if (shape->release != psg_shape_old.release) {
+    sprintf(s, "%03d", shape->release);
+    vdp_puts(VDP_PLAN_A, s, 12, 4);
+    psg_shape_old.release = shape->release;
+  }
+  if (shape->arp != psg_shape_old.arp) {
+    sprintf(s, "%03d", shape->arp);
+    vdp_puts(VDP_PLAN_A, s, 12, 5);
+    vdp_puts(VDP_PLAN_A, macro_name(MACRO_ARP, shape->arp), 17, 5);
+    psg_shape_old.arp = shape->arp;
+  }
+  if (shape->pitch != psg_shape_old.pitch) {
+    sprintf(s, "%03d", shape->pitch);
+    vdp_puts(VDP_PLAN_A, s, 12, 6);
+    vdp_puts(VDP_PLAN_A, macro_name(MACRO_PITCH, shape->pitch), 17, 6);
+    psg_shape_old.pitch = shape->pitch;
+  }
+  if (shape->noise != psg_shape_old.noise) {
+    sprintf(s, "%03d", shape->noise);
+    vdp_puts(VDP_PLAN_A, s, 12, 7);
+    vdp_puts(VDP_PLAN_A, macro_name(MACRO_NOISE, shape->noise), 17, 7);
+    psg_shape_old.noise = shape->noise;
+  }
+}
+
+// the next param the track can lock after param in direction dir, -1 past the
+// last one. param -1 and dir 1 give the first
+static int lock_next_param(int param, int8_t dir) {
+  for (param += dir; param >= 0 && param < PLOCK_PARAM_COUNT; param += dir) {
+    if (trackLockMask[lock_track] & (1 << param)) return param;
+  }
+  return -1;
+}
+
+void displayLockScreen() {
+
+  char s[255];
+  uint8_t pattern = editPattern[lock_track];
+  const plock_list_t *list = patternLocks[lock_track][pattern];
+  uint8_t length = patternLength[lock_track][pattern];
+
+  if (lock_step >= length) lock_step = length - 1;
+  if (!(trackLockMask[lock_track] & (1 << lock_param))) lock_param = lock_next_param(-1, 1);
+  int16_t value = plock_get(list, lock_step, lock_param);
+
+  if (screen != oldscreen) {
+
+    clearScreen();
+    vdp_puts(VDP_PLAN_A, "LOCKS", SCREEN_TILEW - 8, 0);
+
+    vdp_puts(VDP_PLAN_A, "track     :", 0, 0);
+    vdp_puts(VDP_PLAN_A, "step      :", 0, 1);
+    vdp_puts(VDP_PLAN_A, "param     :", 0, 2);
+    vdp_puts(VDP_PLAN_A, "value     :", 0, 3);
+    lock_track_old = 255; // values printed below
+    lock_step_old = 255;
+    lock_param_old = 255;
+    lock_value_old = -2;
+    lockListStale = 1;
+
+    vdp_puts(VDP_PLAN_A, ">", 11, lock_select_field);
+    vdp_puts(VDP_PLAN_A, "<", 15, lock_select_field);
+    lock_select_field_old = lock_select_field;
+  }
+
+  if (lock_select_field != lock_select_field_old) {
+    vdp_puts(VDP_PLAN_A, " ", 11, lock_select_field_old);
+    vdp_puts(VDP_PLAN_A, " ", 15, lock_select_field_old);
+    vdp_puts(VDP_PLAN_A, ">", 11, lock_select_field);
+    vdp_puts(VDP_PLAN_A, "<", 15, lock_select_field);
+    lock_select_field_old = lock_select_field;
+  }
+  if (lock_track != lock_track_old) {
+    static const char *const trackNames[TRACK_COUNT] = {"pcm", "psg", "ym ", "ch3"};
+    sprintf(s, "%03d", lock_track);
+    vdp_puts(VDP_PLAN_A, s, 12, 0);
+    sprintf(s, "%s pat %02d", trackNames[lock_track], pattern);
+    vdp_puts(VDP_PLAN_A, s, 17, 0);
+    lock_track_old = lock_track;
+    lockListStale = 1;
+  }
+  if (lock_step != lock_step_old) {
+    sprintf(s, "%03d", lock_step);
+    vdp_puts(VDP_PLAN_A, s, 12, 1);
+    lock_step_old = lock_step;
+    lock_value_old = -2;
+  }
+  if (lock_param != lock_param_old) {
+    sprintf(s, "%03d", lock_param);
+    vdp_puts(VDP_PLAN_A, s, 12, 2);
+    vdp_puts(VDP_PLAN_A, plock_name(lock_param), 17, 2);
+    lock_param_old = lock_param;
+    lock_value_old = -2;
+  }
+  if (value != lock_value_old) {
+    vdp_text_clear(VDP_PLAN_A, 17, 3, 5);
+    if (value < 0) {
+      vdp_puts(VDP_PLAN_A, "off", 12, 3);
+    } else {
+      sprintf(s, "%03d", value);
+      vdp_puts(VDP_PLAN_A, s, 12, 3);
+      if (lock_param == PLOCK_COND) vdp_puts(VDP_PLAN_A, trig_name(value), 17, 3);
+    }
+    lock_value_old = value;
+  }
+
+  // every lock of the pattern, one per row
+  if (lockListStale) {
+    for (int i = 0; i < PLOCK_MAX; i++) {
+      vdp_text_clear(VDP_PLAN_A, 0, LOCK_LIST_ROW + i, 20);
+      if (i < list->count) {
+	const plock_t *l = &list->lock[i];
+	if (l->param == PLOCK_COND) {
+	  sprintf(s, "st %02d %s %s", l->step, plock_name(l->param), trig_name(l->value));
+	} else {
+	  sprintf(s, "st %02d %s %03d", l->step, plock_name(l->param), l->value);
+	}
+	vdp_puts(VDP_PLAN_A, s, 0, LOCK_LIST_ROW + i);
+      }
+    }
+    lockListStale = 0;
+  }
+}
+
+// what a new lock starts from, the instrument value it takes the place of
+static uint8_t lock_base() {
+  if (lock_param == PLOCK_NUDGE || lock_param == PLOCK_COND) return plock_min(lock_param);
+  if (lock_param == PLOCK_RATE) return pcmSeq[lock_step].speed;
+  if (lock_param == PLOCK_VOLUME) return PSG_VOLUME_DEFAULT;
+  if (lock_param == PLOCK_FEEDBACK) return lock_track == TRACK_YM3 ? 0 : ym_feedback;
+  return ym_level[(lock_track == TRACK_YM3 ? 2 : 0) * 4 + lock_param - PLOCK_TL];
+}
+
+// left and right on the lock screen. right from off starts the lock at the
+// instrument value, left past the smallest value takes the lock off again
+void lock_edit(int8_t dir) {
+  plock_list_t *list = patternLocks[lock_track][editPattern[lock_track]];
+  int16_t value = plock_get(list, lock_step, lock_param);
+
+  if (lock_select_field == LOCK_FIELD_TRACK) {
+    if ((dir < 0 && lock_track > 0) || (dir > 0 && lock_track < TRACK_COUNT - 1)) {
+      lock_track += dir;
+      lock_param = lock_next_param(-1, 1);
+    }
+  } else if (lock_select_field == LOCK_FIELD_STEP) {
+    if (dir < 0 && lock_step > 0) lock_step--;
+    if (dir > 0 && lock_step < patternLength[lock_track][editPattern[lock_track]] - 1) lock_step++;
+  } else if (lock_select_field == LOCK_FIELD_PARAM) {
+    int param = lock_next_param(lock_param, dir);
+    if (param >= 0) lock_param = param;
+  } else if (lock_select_field == LOCK_FIELD_VALUE) {
+    if (value < 0) {
+      if (dir < 0) return;
+      value = lock_base();
+    } else {
+      value += dir;
+      if (value > plock_max(lock_param)) return;
+    }
+
+    if (value >= plock_min(lock_param)) {
+      list = locks_claim(lock_track, editPattern[lock_track]);
+      if (!list) {
+	pattern_memory_full();
+	return;
+      }
+    }
+
+    uint8_t ok = 1;
+    disable_ints; // the vblank handler reads the list while it plays
+    if (value < plock_min(lock_param)) {
+      plock_remove(list, lock_step, lock_param);
+    } else {
+      ok = plock_set(list, lock_step, lock_param, value);
+    }
+    enable_ints;
+
+    lockListStale = 1;
+    if (ok) {
+      savegame();
+    } else {
+      vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+      vdp_puts(VDP_PLAN_A, "pattern lock list full", 3, STATUS_ROW);
+    }
+  }
+}
+
+// print the cells record_hit wrote, when their step is on the page shown
+static void record_draw(int track, int step) {
+  int row = STEP_ROW(step);
+
+  if (PAGE_FIRST(step) != shownPage) return;
+  if (track == TRACK_PCM) {
+    sprintf(s, "%02d", pcmSeq[step].sample);
+    vdp_puts(VDP_PLAN_A, s, 6, row);
+    sprintf(s, "%02d", pcmSeq[step].flags & PCM_STEP_ACCENT);
+    vdp_puts(VDP_PLAN_A, s, 9, row);
+    sprintf(s, "%02X", pcmSeq[step].speed);
+    vdp_puts(VDP_PLAN_A, s, 12, row);
+  } else if (track == TRACK_PSG) {
+    for (int col = column & ~1; col <= (column | 1); col++) {
+      sprintf(s, "%02d", *psg_lane(step, col));
+      vdp_puts(VDP_PLAN_A, s, 6 + col * 3, row);
+    }
+  } else {
+    sprintf(s, "%02d", track == TRACK_YM ? ymSeq[step].note[column] : ym3Seq[step].note[column]);
+    vdp_puts(VDP_PLAN_A, s, 6 + column * 3, row);
+  }
+}
+
+// live record: copy the cell under the cursor to the step nearest the press.
+// the pad is only read once a frame, so the press came on average half the
+// ticks of the last frame before it was seen, and the trim covers the time
+// the sound takes to reach the player. the pcm track copies the whole step,
+// psg the note and volume of the channel
+void record_hit() {
+  int track = screen_track();
+  uint8_t pos, ticks, length, pattern;
+  int16_t at;
+
+  disable_ints; // one consistent position
+  pos = trackPos[track];
+  at = trackTick[track];
+  ticks = playRow.ticks[track];
+  length = playRow.length[track];
+  pattern = playRow.pattern[track];
+  enable_ints;
+
+  if (pattern != editPattern[track]) {
+    vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+    vdp_puts(VDP_PLAN_A, "not the pattern playing", 3, STATUS_ROW);
+    return;
+  }
+
+  at -= (pollTicks >> 1) + recTrim;
+  while (at < 0) {
+    at += ticks;
+    pos = pos ? pos - 1 : length - 1;
+  }
+  if (at >= (ticks + 1) >> 1) { // closer to the next step
+    if (++pos >= length) pos = 0;
+  }
+  if (pos == selectstep) return; // already there
+
+  disable_ints; // the step may be playing, it has to change in one go
+  if (track == TRACK_PCM) {
+    pcmSeq[pos] = pcmSeq[selectstep];
+  } else if (track == TRACK_PSG) {
+    psgSeq[pos].note[column >> 1] = psgSeq[selectstep].note[column >> 1];
+    psgSeq[pos].vol[column >> 1] = psgSeq[selectstep].vol[column >> 1];
+  } else if (track == TRACK_YM) {
+    ymSeq[pos].note[column] = ymSeq[selectstep].note[column];
+    ym_step_compile(&ymSeq[pos]);
+  } else {
+    ym3Seq[pos].note[column] = ym3Seq[selectstep].note[column];
+    ym3_step_compile(&ym3Seq[pos]);
+  }
+  enable_ints;
+  savegame();
+
+  record_draw(track, pos);
+  vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+  sprintf(s, "recorded step %02d", pos);
+  vdp_puts(VDP_PLAN_A, s, 3, STATUS_ROW);
+}
+
 void displayProjectScreen() {
 
   char s[255];
@@ -1006,23 +2307,523 @@ void displayProjectScreen() {
     clearScreen();
     vdp_puts(VDP_PLAN_A, "PROJECT", SCREEN_TILEW - 8, 0);
 
-    vdp_puts(VDP_PLAN_A, "tempo:", 0, 0);
-    sprintf(s, "%03d", tempo);
-    vdp_puts(VDP_PLAN_A, s, 12, 0);
+    vdp_puts(VDP_PLAN_A, "bpm       :", 0, 0);
+    vdp_puts(VDP_PLAN_A, "bpm fine  :", 0, 4);
+    bpm_old = 0xFFFF; // printed below
+
+    vdp_puts(VDP_PLAN_A, "ch3 mode  :", 0, 1);
+    sprintf(s, "%03d", ym_ch3_special);
+    vdp_puts(VDP_PLAN_A, s, 12, 1);
+
+    vdp_puts(VDP_PLAN_A, "clock     :", 0, 2);
+    vdp_puts(VDP_PLAN_A, seq_clock == SEQ_CLOCK_TIMER_A ? "tmr" : "vbl", 12, 2);
+
+    vdp_puts(VDP_PLAN_A, "timer a   :", 0, 3);
+    sprintf(s, "%04d", timer_a_value);
+    vdp_puts(VDP_PLAN_A, s, 12, 3);
+
+    vdp_puts(VDP_PLAN_A, "song mode :", 0, 5);
+    vdp_puts(VDP_PLAN_A, "song len  :", 0, 6);
+    vdp_puts(VDP_PLAN_A, "pcm pat   :", 0, 7);
+    vdp_puts(VDP_PLAN_A, "psg pat   :", 0, 8);
+    vdp_puts(VDP_PLAN_A, "ym pat    :", 0, 9);
+    vdp_puts(VDP_PLAN_A, "ch3 pat   :", 0, 10);
+    vdp_puts(VDP_PLAN_A, "pcm len   :", 0, 11);
+    vdp_puts(VDP_PLAN_A, "psg len   :", 0, 12);
+    vdp_puts(VDP_PLAN_A, "ym len    :", 0, 13);
+    vdp_puts(VDP_PLAN_A, "ch3 len   :", 0, 14);
+    vdp_puts(VDP_PLAN_A, "swing     :", 0, 15);
+    vdp_puts(VDP_PLAN_A, "groove    :", 0, 16);
+    vdp_puts(VDP_PLAN_A, "pcm rate  :", 0, 17);
+    vdp_puts(VDP_PLAN_A, "psg rate  :", 0, 18);
+    vdp_puts(VDP_PLAN_A, "ym rate   :", 0, 19);
+    vdp_puts(VDP_PLAN_A, "ch3 rate  :", 0, 20);
+    vdp_puts(VDP_PLAN_A, "record    :", 0, 21);
+    vdp_puts(VDP_PLAN_A, "rec trim  :", 0, 22);
+
+    vdp_puts(VDP_PLAN_A, "free", 26, 16);
+    vdp_puts(VDP_PLAN_A, "pcm", 26, 17);
+    vdp_puts(VDP_PLAN_A, "psg", 26, 18);
+    vdp_puts(VDP_PLAN_A, "ym", 26, 19);
+    vdp_puts(VDP_PLAN_A, "ch3", 26, 20);
+    vdp_puts(VDP_PLAN_A, "lock", 26, 21);
+    vdp_puts(VDP_PLAN_A, "ram", 26, 22);
+    for (int i = 0; i <= TRACK_COUNT; i++) {
+      blocksFree_old[i] = 255; // printed below
+    }
+    ramFree_old = 0;
+    songMode_old = 255; // printed below
+    seq_swing_old = 255;
+    seq_groove_old = 255;
+    recording_old = 255;
+    recTrim_old = 255;
+    songLength_old = 255;
+    for (int t = 0; t < TRACK_COUNT; t++) {
+      editPattern_old[t] = 255;
+      patternLength_old[t] = 255;
+      patternRate_old[t] = 255;
+    }
+
+    vdp_puts(VDP_PLAN_A, "ym cyc/wr", 0, 23);
+    sprintf(s, "old %04d new %04d", ymWritesOld, ymWritesTuned);
+    vdp_puts(VDP_PLAN_A, s, 12, 23);
+
+    vdp_puts(VDP_PLAN_A, "tmr jitter:", 0, 24);
+    timerJitter_old = 0xFFFF; // printed below
+
+    vdp_puts(VDP_PLAN_A, "ym reset  :", 0, 25);
+    sprintf(s, "%03d lines", ymResetLines);
+    vdp_puts(VDP_PLAN_A, s, 12, 25);
+
+    vdp_puts(VDP_PLAN_A, ">", 11, project_select_field);
+    vdp_puts(VDP_PLAN_A, "<", 15, project_select_field);
+    project_select_field_old = project_select_field;
 
   } else {
-    if (tempo != tempo_old) {
-      sprintf(s, "%03d", tempo);
+    if (project_select_field != project_select_field_old) {
+      vdp_puts(VDP_PLAN_A, " ", 11, project_select_field_old);
+      vdp_puts(VDP_PLAN_A, " ", 15, project_select_field_old);
+      vdp_puts(VDP_PLAN_A, ">", 11, project_select_field);
+      vdp_puts(VDP_PLAN_A, "<", 15, project_select_field);
+      project_select_field_old = project_select_field;
+    }
+    if (bpm != bpm_old) {
+      sprintf(s, "%03d", bpm / 10);
       vdp_puts(VDP_PLAN_A, s, 12, 0);
-      tempo_old = tempo;
+      sprintf(s, "%03d", bpm % 10);
+      vdp_puts(VDP_PLAN_A, s, 12, 4);
+      sprintf(s, "%3d.%d", bpm / 10, bpm % 10);
+      vdp_puts(VDP_PLAN_A, s, 17, 0);
+      bpm_old = bpm;
+    }
+    if (ym_ch3_special != ym_ch3_special_old) {
+      sprintf(s, "%03d", ym_ch3_special);
+      vdp_puts(VDP_PLAN_A, s, 12, 1);
+      ym_ch3_special_old = ym_ch3_special;
+    }
+    if (seq_clock != seq_clock_old) {
+      vdp_puts(VDP_PLAN_A, seq_clock == SEQ_CLOCK_TIMER_A ? "tmr" : "vbl", 12, 2);
+      seq_clock_old = seq_clock;
+    }
+    if (timer_a_value != timer_a_value_old) {
+      sprintf(s, "%04d", timer_a_value);
+      vdp_puts(VDP_PLAN_A, s, 12, 3);
+      timer_a_value_old = timer_a_value;
+    }
+  }
+
+  // song and pattern fields, printed on the first pass too
+  if (songMode != songMode_old) {
+    sprintf(s, "%03d", songMode);
+    vdp_puts(VDP_PLAN_A, s, 12, 5);
+    songMode_old = songMode;
+  }
+  if (songLength != songLength_old) {
+    sprintf(s, "%03d", songLength);
+    vdp_puts(VDP_PLAN_A, s, 12, 6);
+    songLength_old = songLength;
+  }
+  if (seq_swing != seq_swing_old) {
+    sprintf(s, "%03d", seq_swing);
+    vdp_puts(VDP_PLAN_A, s, 12, PROJECT_FIELD_SWING);
+    sprintf(s, "%02d%%", 50 + seq_swing * 50 / SEQ_TICKS_PER_STEP);
+    vdp_puts(VDP_PLAN_A, s, 17, PROJECT_FIELD_SWING);
+    seq_swing_old = seq_swing;
+  }
+  if (recording != recording_old) {
+    sprintf(s, "%03d", recording);
+    vdp_puts(VDP_PLAN_A, s, 12, PROJECT_FIELD_RECORD);
+    recording_old = recording;
+  }
+  if (recTrim != recTrim_old) {
+    sprintf(s, "%03d", recTrim);
+    vdp_puts(VDP_PLAN_A, s, 12, PROJECT_FIELD_REC_TRIM);
+    recTrim_old = recTrim;
+  }
+  if (seq_groove != seq_groove_old) {
+    sprintf(s, "%03d", seq_groove);
+    vdp_puts(VDP_PLAN_A, s, 12, PROJECT_FIELD_GROOVE);
+    vdp_puts(VDP_PLAN_A, groove_name(seq_groove), 17, PROJECT_FIELD_GROOVE);
+    seq_groove_old = seq_groove;
+  }
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    int length = patternLength[t][editPattern[t]];
+    if (editPattern[t] != editPattern_old[t]) {
+      sprintf(s, "%03d", editPattern[t]);
+      vdp_puts(VDP_PLAN_A, s, 12, PROJECT_FIELD_PATTERN + t);
+      editPattern_old[t] = editPattern[t];
+    }
+    if (length != patternLength_old[t]) {
+      sprintf(s, "%03d", length);
+      vdp_puts(VDP_PLAN_A, s, 12, PROJECT_FIELD_LENGTH + t);
+      patternLength_old[t] = length;
+    }
+    if (patternRate[t][editPattern[t]] != patternRate_old[t]) {
+      uint8_t rate = patternRate[t][editPattern[t]];
+      sprintf(s, "%03d", rate);
+      vdp_puts(VDP_PLAN_A, s, 12, PROJECT_FIELD_RATE + t);
+      vdp_puts(VDP_PLAN_A, rateNames[rate], 17, PROJECT_FIELD_RATE + t);
+      patternRate_old[t] = rate;
+    }
+  }
+
+  // memory left: free blocks of each pool, then the ram between the globals
+  // and the stack
+  for (int i = 0; i <= TRACK_COUNT; i++) {
+    const pool_t *pool = i < TRACK_COUNT ? &stepPools[i] : &lockPool;
+    uint8_t left = pool->count - pool->used;
+    if (left != blocksFree_old[i]) {
+      sprintf(s, "%02d/%02d", left, pool->count);
+      vdp_puts(VDP_PLAN_A, s, 31, 17 + i);
+      blocksFree_old[i] = left;
+    }
+  }
+  if (ram_free() != ramFree_old) {
+    ramFree_old = ram_free();
+    sprintf(s, "%05u", ramFree_old);
+    vdp_puts(VDP_PLAN_A, s, 31, 22);
+  }
+
+  // worst timer tick latency, in scanlines of 64us
+  if (timerJitter != timerJitter_old) {
+    sprintf(s, "%03d lines", timerJitter);
+    vdp_puts(VDP_PLAN_A, s, 12, 24);
+    timerJitter_old = timerJitter;
+  }
+}
+
+// levels and feedback of a channel keyed on this step: the locked values, or
+// the instrument's where nothing is locked. the shadows drop every write the
+// chip already has, so only a lock or the step after one costs bus time
+static void ym_apply_locks(uint8_t ch, const plock_step_t *locks, uint8_t fbAlgo) {
+  for (uint8_t op = 0; op < YM_OP_COUNT; op++) {
+    if (locks->mask & (1 << (PLOCK_TL + op))) {
+      ym_set_tl(ch, op, locks->value[PLOCK_TL + op]);
+    } else {
+      ym_set_tl(ch, op, ym_level[ch * 4 + op]);
+    }
+  }
+  if (locks->mask & (1 << PLOCK_FEEDBACK)) {
+    fbAlgo = (fbAlgo & 0x07) | (locks->value[PLOCK_FEEDBACK] << 3);
+  }
+  ym_set_fb_algo(ch, fbAlgo);
+}
+
+// look the locks of a track's new step up once and work out the tick it is
+// due on. swing and the groove hold the odd steps back, a nudge lock one step.
+// it stays inside the step, so fast tracks get less room to move
+static void sequencer_schedule(uint8_t t) {
+  plock_step_t *locks = &stepLocks[t];
+  uint8_t pos = trackPos[t];
+  uint8_t due = groove_offset(seq_groove, pos) + ((pos & 1) ? seq_swing : 0);
+
+  plock_step(playRow.locks[t], pos, locks);
+  if ((locks->mask & (1 << PLOCK_COND)) &&
+      !trig_pass(locks->value[PLOCK_COND], &trackLoops[t], fillMode)) {
+    return; // sits this one out
+  }
+  if (locks->mask & (1 << PLOCK_NUDGE)) due += locks->value[PLOCK_NUDGE];
+  trackDue[t] = due < playRow.ticks[t] ? due : playRow.ticks[t] - 1;
+  pendingTracks |= 1 << t;
+}
+
+// send everything that triggers on the step for the tracks set in the mask.
+// the fm tracks still share one batch when they are due on the same tick
+static void sequencer_fire(uint8_t tracks) {
+  // one record per track
+  const pcm_step_t *pcm = &playRow.pcm[trackPos[TRACK_PCM]];
+  const psg_step_t *psg = &playRow.psg[trackPos[TRACK_PSG]];
+  const ym_step_t *ym = &playRow.ym[trackPos[TRACK_YM]];
+  const ym3_step_t *ym3 = &playRow.ym3[trackPos[TRACK_YM3]];
+  const plock_step_t *locks = stepLocks;
+
+  /* psg sequencer */
+  uint8_t psgTracks = (tracks & (1 << TRACK_PSG)) ? PSG_TRACK_COUNT : 0;
+  for (uint8_t t = 0; t < psgTracks; t++) {
+    int note = psg->note[t];
+    int vol = psg->vol[t];
+    if (note) {
+      // on the noise track modes 4 and 8 follow tone 3, so track 3 can set the noise pitch
+      if (vol < 0) {
+	psgenv_note_on(t, note - 1, 0);
+      } else if (locks[TRACK_PSG].mask & (1 << PLOCK_VOLUME)) {
+	psgenv_note_on(t, note - 1, locks[TRACK_PSG].value[PLOCK_VOLUME]);
+      } else {
+	psgenv_note_on(t, note - 1, vol ? vol : PSG_VOLUME_DEFAULT);
+      }
+    } else {
+      psgenv_note_off(t);
+    }
+  }
+
+  /* ym sequencer */
+  uint8_t keys = (tracks & (1 << TRACK_YM)) ? ym->keys : 0;
+  uint8_t chord = keys & YM_STEP_CHORD;
+
+  /* ym channel 3 special mode sequencer */
+  uint8_t ch3 = ym_ch3_special && (tracks & (1 << TRACK_YM3));
+  uint8_t retrig = ch3 ? ym3->on : 0;
+  uint8_t release = ch3 ? ym3->off : 0;
+
+  // both fm tracks queue their key changes and send them in one batch
+  if (keys || retrig || release) {
+    Z80_requestBus(1);
+    if (chord) {
+      // a new chord releases the last one, its tails ring out on the spare voices
+      ymvoice_release_all();
+      for (int n = 0; n < YM_CHORD_MAX; n++) {
+        if (chord & (1 << n)) {
+          uint8_t ch = ymvoice_play(n, ym->note[n]);
+          ym_apply_locks(ch, &locks[TRACK_YM], (ym_feedback << 3) | ym_algo);
+        }
+      }
+    } else if (keys & YM_STEP_OFF) {
+      ymvoice_release_all();
+    }
+
+    if (retrig || release) {
+      if (retrig) ym_apply_locks(2, &locks[TRACK_YM3], YM3_FB_ALGO);
+      for (int op = 0; op < YM3_OP_COUNT; op++) {
+        if (retrig & (1 << op)) {
+          ym_set_op_fnum(op, ym3->regs[op]);
+        }
+      }
+      ym3KeyMask = (ym3KeyMask & ~release) | retrig;
+      ym_key_queue(2, ym3KeyMask, retrig);
+    }
+
+    ym_key_flush();
+    YM2612_latchDacDataReg();
+    Z80_releaseBus();
+  }
+
+  /* pcm sequencer */
+  if ((tracks & (1 << TRACK_PCM)) && pcm->sample) { // do we need to play a sample?
+    uint8_t speed = pcm->speed;
+    if (locks[TRACK_PCM].mask & (1 << PLOCK_RATE)) speed = locks[TRACK_PCM].value[PLOCK_RATE];
+    pcm_trigger(pcm, speed);
+  } else {
+    // we have to stop the sample if it's not set every step or we hear noise.
+    // didn't happen until I added the ym code
+//  stop_sample();
+  }
+}
+
+// move every track on by a tick, a track at the end of its step goes to the
+// next one and shorter patterns loop
+static void sequencer_advance() {
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    if (++trackTick[t] >= playRow.ticks[t]) {
+      trackTick[t] = 0;
+      if (++trackPos[t] >= playRow.length[t]) {
+	trackPos[t] = 0;
+	trig_loops_next(&trackLoops[t]);
+      }
+    }
+  }
+
+  // the longest track ends the row and the row looked up in advance takes
+  // over. song rows start every track together, looped patterns keep going
+  // so tracks of different lengths and rates drift against each other.
+  // vblank_handler looks the next row up once a frame, a row shorter than a
+  // frame or an edit since then has it looked up here on the tick
+  if (++rowTick >= playRow.rowTicks) {
+    rowTick = 0;
+    if (nextRowStale) {
+      nextRowStale = 0;
+      song_resolve_next();
+    }
+    playRow = nextRow;
+    songpos = playRow.row;
+    nextRowStale = 1;
+    for (int t = 0; t < TRACK_COUNT; t++) {
+      if (songMode || trackPos[t] >= playRow.length[t] || trackTick[t] >= playRow.ticks[t]) {
+	trackPos[t] = 0;
+	trackTick[t] = 0;
+	pendingTracks &= ~(1 << t);
+      }
     }
   }
 }
 
+// one clock tick of playback: tracks starting a step are scheduled, then
+// whichever are due fire. each track counts its own ticks, so the work per
+// tick only grows with the number of tracks, not with rates or lengths
+static void sequencer_tick() {
+  uint8_t due = 0;
+
+  if (!seqStarted) {
+    if (stepTicks) return;
+    seqStarted = 1;
+  }
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    if (trackTick[t] == 0) sequencer_schedule(t);
+    if ((pendingTracks & (1 << t)) && trackDue[t] <= trackTick[t]) due |= 1 << t;
+  }
+  if (due) {
+    pendingTracks &= ~due;
+    sequencer_fire(due);
+  }
+  sequencer_advance();
+}
+
+// move the clock on by units / perSecond seconds and play every tick of it.
+// a tick is 600 / (bpm * SEQ_PPQN) seconds, so scaling both sides to whole
+// numbers keeps the remainder exact and the clock never drifts
+static void seq_clock_advance(uint16_t units, uint32_t perSecond) {
+  uint32_t tick = 600 * perSecond;
+
+  clockAcc += (uint32_t)bpm * SEQ_PPQN * units;
+  while (clockAcc >= tick) {
+    clockAcc -= tick;
+    if (++stepTicks >= SEQ_TICKS_PER_STEP) stepTicks = 0;
+    clockTicks++;
+    if (playing) sequencer_tick();
+  }
+}
+
+// poll timer A, each overflow moves the clock on by the timer period. the
+// lines since the last poll are how late the tick could have been seen
+static void timer_poll() {
+  uint8_t line = vdp_get_vcount();
+
+  if (seq_clock != SEQ_CLOCK_TIMER_A) return;
+
+  Z80_requestBus(1);
+  uint8_t overflow = ym_timer_a_poll();
+  if (overflow) YM2612_latchDacDataReg(); // the acknowledge moved the ym address
+  Z80_releaseBus();
+
+  if (overflow) {
+    uint8_t late = line - timerPollLine;
+    if (late > timerJitter) timerJitter = late;
+    seq_clock_advance(1024 - timerCounting, pal_mode ? YM_TIMER_A_RATE_PAL : YM_TIMER_A_RATE_NTSC);
+    timerCounting = timer_a_value;
+  }
+  timerPollLine = line;
+}
+
+// called from the horizontal interrupt in boot.s every TIMER_POLL_LINES
+// lines of the display while timer A is the clock. boot.s masks the vblank
+// interrupt, so the two never share the z80 bus
+void hblank_handler() {
+  timer_poll();
+}
+
+// one queued ui edit, on the sound side
+static void sound_run(uint16_t entry) {
+  uint8_t arg = entry >> 8;
+
+  switch (entry & 0xFF) {
+  case SOUND_LFO:
+    set_ym_lfo(ym_lfo_enable, ym_lfo_speed);
+    break;
+  case SOUND_DETUNE_MULT:
+    set_ym_detune_mult(ym_detune, ym_mult);
+    break;
+  case SOUND_LEVEL:
+    set_ym_level(arg >> 2, arg & 3, ym_level[arg]);
+    break;
+  case SOUND_SSGEG:
+    set_ym_ssgeg(arg >> 2, arg & 3, ym_ssgeg[arg]);
+    break;
+  case SOUND_ATTACK:
+    set_ym_attack(ym_attack);
+    break;
+  case SOUND_RELEASE_SUSTAIN:
+    set_ym_release_sustain(ym_release, ym_sustain);
+    break;
+  case SOUND_DECAY_AM:
+    set_ym_decay_am(ym_decay, ym_am);
+    break;
+  case SOUND_FEEDBACK_ALGO:
+    set_ym_feedback_algo(ym_feedback, ym_algo);
+    break;
+  case SOUND_PAN_AMS_FMS:
+    set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+    break;
+  case SOUND_INSTRUMENT:
+    ym_apply_instrument();
+    break;
+  case SOUND_PITCH_MOD:
+    ymvoice_set_pitch_mod(ym_glide, ym_vib_speed, ym_vib_depth, ym_bend);
+    break;
+  case SOUND_LEGATO:
+    ymvoice_set_legato(ym_legato, ym_algo);
+    break;
+  case SOUND_MACROS:
+    ymvoice_set_macros(ym_arp, ym_pitch_macro);
+    break;
+  case SOUND_CH3_MODE:
+    set_ym_ch3_mode(ym_ch3_special);
+    break;
+  case SOUND_SEQ_CLOCK:
+    set_seq_clock(seq_clock);
+    break;
+  case SOUND_TIMER_A:
+    set_timer_a_period();
+    break;
+  case SOUND_STOP:
+    playing = 0;
+    stop_sample(); // stop any playing
+    psgenv_release_all();
+    Z80_requestBus(1);
+    ymvoice_release_all();
+    ym_key_flush();
+    ym3KeyMask = 0;
+    ym_key_ops(2, ym3KeyMask);
+    YM2612_latchDacDataReg();
+    Z80_releaseBus();
+    break;
+  case SOUND_START:
+    song_rewind();
+    playing = 1;
+    break;
+  case SOUND_PANIC:
+    playing = 0;
+    stop_sample();
+    psg_silence();
+    ym3KeyMask = 0;
+    YM2612_reset(1);
+    set_ym_ch3_mode(ym_ch3_special); // also applies the instrument
+    set_seq_clock(seq_clock);
+    break;
+  }
+}
+
+// called from the vblank interrupt in boot.s. everything that writes the
+// sound chips runs here, so a slow redraw in the main loop can't delay a step
+void vblank_handler() {
+  while (soundTail != soundHead) {
+    sound_run(soundQueue[soundTail]);
+    soundTail = (soundTail + 1) & (SOUND_QUEUE_SIZE - 1);
+  }
+
+  if (nextRowStale) {
+    nextRowStale = 0;
+    song_resolve_next();
+  }
+
+  // check if we need to update the sequencer, FPS is 50 on pal
+  if (seq_clock == SEQ_CLOCK_VSYNC) {
+    seq_clock_advance(1, FPS);
+  } else {
+    timer_poll(); // no horizontal interrupts until the display starts again
+  }
+
+  ymvoice_tick(); // glide and vibrato, once a frame whatever the step clock
+  psgenv_tick();
+
+  Z80_requestBus(1);
+  meterLevel = Z80_read(outputValue_addr);
+  Z80_releaseBus();
+
+  frame++;
+}
+
 int main() {
 
   vdp_init();
-  enable_ints;
     
   vdp_color(0, 0x888); // background
 
@@ -1040,9 +2841,22 @@ int main() {
   Z80_loadDriverInternal(z80driver_bin, z80driver_bin_len);
   set_kit_bank(); // let z80 access our pcm data
 
+  vdp_vsync(); // time the reset from the top of the display
   YM2612_reset(1);
+  ymResetLines = vdp_get_vcount();
+  ymvoice_init(YM_VOICES_ALL);
+  psgenv_init();
+
+  // measure ym bus throughput while nothing is playing
+  Z80_requestBus(1);
+  ymWritesOld = YM2612_benchmarkWrites(0);
+  ymWritesTuned = YM2612_benchmarkWrites(1);
+  YM2612_latchDacDataReg();
+  Z80_releaseBus();
 
+  patterns_init();
   savegame_init(); // after resetting ym2612  
+  song_rewind();
 
   vdp_tiles_load(blankTile, 100, 1);
   vdp_tiles_load(fillTile, 101, 1);
@@ -1054,9 +2868,14 @@ int main() {
     }
   }
 
+  // from here on the sound chips belong to vblank_handler and hblank_handler
+  enable_ints;
+
   while(1) {
     
     read_controller1(&player1_state);
+    pollTicks = clockTicks - lastPollTicks; // how long a press can wait to be seen
+    lastPollTicks = clockTicks;
 
     // check if down was pressed
     if (player1_state.down) {
@@ -1064,8 +2883,17 @@ int main() {
 	if (screen == SCREEN_YM_INST) {
 	  ym_select_field++;
 	  if (ym_select_field >= YM_FIELD_COUNT) ym_select_field = YM_FIELD_COUNT - 1;
+	} else if (screen == SCREEN_PROJECT) {
+	  project_select_field++;
+	  if (project_select_field >= PROJECT_FIELD_COUNT) project_select_field = PROJECT_FIELD_COUNT - 1;
+	} else if (screen == SCREEN_PSG_INST) {
+	  psg_select_field++;
+	  if (psg_select_field >= PSG_FIELD_COUNT) psg_select_field = PSG_FIELD_COUNT - 1;
+	} else if (screen == SCREEN_LOCKS) {
+	  lock_select_field++;
+	  if (lock_select_field >= LOCK_FIELD_COUNT) lock_select_field = LOCK_FIELD_COUNT - 1;
 	} else {
-	  selectstep = (selectstep + 1) % 16;
+	  selectstep = (selectstep + 1) % screen_steps();
 	}
 	downpressed = 1;
       }
@@ -1079,9 +2907,18 @@ int main() {
 	if (screen == SCREEN_YM_INST) {
 	  ym_select_field--;
 	  if (ym_select_field < 0) ym_select_field = 0;
+	} else if (screen == SCREEN_PROJECT) {
+	  project_select_field--;
+	  if (project_select_field < 0) project_select_field = 0;
+	} else if (screen == SCREEN_PSG_INST) {
+	  psg_select_field--;
+	  if (psg_select_field < 0) psg_select_field = 0;
+	} else if (screen == SCREEN_LOCKS) {
+	  lock_select_field--;
+	  if (lock_select_field < 0) lock_select_field = 0;
 	} else {
 	  selectstep = selectstep - 1;
-	  if (selectstep < 0) selectstep = 15;
+	  if (selectstep < 0) selectstep = screen_steps() - 1;
 	}
 	uppressed = 1;	
       }
@@ -1094,127 +2931,297 @@ int main() {
       if (!leftpressed) {
 	if (screen == SCREEN_PCM_SEQ) {
 	  if (column == 0) {
-	    gateseq[selectstep]--;
-	    if (gateseq[selectstep] < 0) gateseq[selectstep] = 0;
+	    if (pcmSeq[selectstep].sample > 0) pcmSeq[selectstep].sample--;
 	
 	    savegame();
 
-	    vdp_text_clear(VDP_PLAN_A, 6, selectstep, 2);
-	    sprintf(s, "%02d", gateseq[selectstep]);
-	    vdp_puts(VDP_PLAN_A, s, 6, selectstep);      
+	    vdp_text_clear(VDP_PLAN_A, 6, STEP_ROW(selectstep), 2);
+	    sprintf(s, "%02d", pcmSeq[selectstep].sample);
+	    vdp_puts(VDP_PLAN_A, s, 6, STEP_ROW(selectstep));      
 	  } else if (column == 1) {
-	    accseq[selectstep]--;
-	    if (accseq[selectstep] < 0) accseq[selectstep] = 0;
+	    pcmSeq[selectstep].flags &= ~PCM_STEP_ACCENT;
 	
 	    savegame();
 
-	    vdp_text_clear(VDP_PLAN_A, 9, selectstep, 2);
-	    sprintf(s, "%02d", accseq[selectstep]);
-	    vdp_puts(VDP_PLAN_A, s, 9, selectstep);      
+	    vdp_text_clear(VDP_PLAN_A, 9, STEP_ROW(selectstep), 2);
+	    sprintf(s, "%02d", pcmSeq[selectstep].flags & PCM_STEP_ACCENT);
+	    vdp_puts(VDP_PLAN_A, s, 9, STEP_ROW(selectstep));      
 
 	  } else if (column == 2) {
 
-	    speedseq[selectstep]--;
-	    if (speedseq[selectstep] < 1) speedseq[selectstep] = 1;
+	    if (pcmSeq[selectstep].speed > 1) pcmSeq[selectstep].speed--;
 	
 	    savegame();
 
-	    vdp_text_clear(VDP_PLAN_A, 12, selectstep, 2);
-	    sprintf(s, "%02d", speedseq[selectstep]);
-	    vdp_puts(VDP_PLAN_A, s, 12, selectstep);      
+	    vdp_text_clear(VDP_PLAN_A, 12, STEP_ROW(selectstep), 2);
+	    sprintf(s, "%02d", pcmSeq[selectstep].speed);
+	    vdp_puts(VDP_PLAN_A, s, 12, STEP_ROW(selectstep));      
 	  }
 	} else if (screen == SCREEN_PSG_SEQ) {
 	  
-	  psgNoteSeq[selectstep]--;
+	  int8_t *lane = psg_lane(selectstep, column);
+	  (*lane)--;
 	  
-	  if (psgNoteSeq[selectstep] < 0) psgNoteSeq[selectstep] = 0;
+	  if (*lane < ((column & 1) ? -1 : 0)) *lane = (column & 1) ? -1 : 0;
 	
 	  savegame();
 
-	  vdp_text_clear(VDP_PLAN_A, 6, selectstep, 2);
-	  sprintf(s, "%02d", psgNoteSeq[selectstep]);
-	  vdp_puts(VDP_PLAN_A, s, 6, selectstep);
+	  vdp_text_clear(VDP_PLAN_A, 6 + column * 3, STEP_ROW(selectstep), 2);
+	  sprintf(s, "%02d", *lane);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));
 	} else if (screen == SCREEN_YM_SEQ) {
 
-	  ymNoteSeq[selectstep]--;
-	  
-	  if (ymNoteSeq[selectstep] < -1) ymNoteSeq[selectstep] = -1;
+	  disable_ints; // the sequencer must not play the note before it is compiled
+	  ymSeq[selectstep].note[column]--;
+	  if (ymSeq[selectstep].note[column] < -1) ymSeq[selectstep].note[column] = -1;
+	  ym_step_compile(&ymSeq[selectstep]);
+	  enable_ints;
 	
 	  savegame();
 
-	  vdp_text_clear(VDP_PLAN_A, 6, selectstep, 2);
-	  sprintf(s, "%02d", ymNoteSeq[selectstep]);
-	  vdp_puts(VDP_PLAN_A, s, 6, selectstep);	  
+	  vdp_text_clear(VDP_PLAN_A, 6 + column * 3, STEP_ROW(selectstep), 2);
+	  sprintf(s, "%02d", ymSeq[selectstep].note[column]);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));	  
 	} else if (screen == SCREEN_YM_INST) {
 	  if (ym_select_field == YM_FIELD_LFO_ENABLE) {
 	    ym_lfo_enable = !ym_lfo_enable;
-	    set_ym_lfo(ym_lfo_enable, ym_lfo_speed);
+	    sound_post(SOUND_LFO, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_LFO_SPEED) {
 	    if (ym_lfo_speed > 0)
 	      ym_lfo_speed--;
-	    set_ym_lfo(ym_lfo_enable, ym_lfo_speed);
+	    sound_post(SOUND_LFO, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_DETUNE) {
 	    if (ym_detune > 0) ym_detune--;
-	    set_ym_detune_mult(ym_detune, ym_mult);
+	    sound_post(SOUND_DETUNE_MULT, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_MULT) {
 	    if (ym_mult > 0) ym_mult--;
-	    set_ym_detune_mult(ym_detune, ym_mult);
+	    sound_post(SOUND_DETUNE_MULT, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_LEVEL) {
 	    if (ym_level[ym_chan * 4 + ym_op] > 0) ym_level[ym_chan * 4 + ym_op]--;
-	    set_ym_level(ym_chan, ym_op, ym_level[ym_chan * 4 + ym_op]);
+	    sound_post(SOUND_LEVEL, ym_chan * 4 + ym_op);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_ATTACK) {
 	    if (ym_attack > 0) ym_attack--;
-	    set_ym_attack(ym_attack);
+	    sound_post(SOUND_ATTACK, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_RELEASE) {
 	    if (ym_attack > 0) ym_release--;
-	    set_ym_release_sustain(ym_release, ym_sustain);
+	    sound_post(SOUND_RELEASE_SUSTAIN, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_SUSTAIN) {
 	    if (ym_sustain > 0) ym_sustain--;
-	    set_ym_release_sustain(ym_release, ym_sustain);
+	    sound_post(SOUND_RELEASE_SUSTAIN, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_DECAY) {
 	    if (ym_decay > 0) ym_decay--;
-	    set_ym_decay_am(ym_decay, ym_am);
+	    sound_post(SOUND_DECAY_AM, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_AM) {
 	    if (ym_am > 0) ym_am--;
-	    set_ym_decay_am(ym_decay, ym_am);
+	    sound_post(SOUND_DECAY_AM, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_FEEDBACK) {
 	    if (ym_feedback > 0) ym_feedback--;
-	    set_ym_feedback_algo(ym_feedback, ym_algo);
+	    sound_post(SOUND_FEEDBACK_ALGO, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_ALGO) {
 	    if (ym_algo > 0) ym_algo--;
-	    set_ym_feedback_algo(ym_feedback, ym_algo);
+	    sound_post(SOUND_FEEDBACK_ALGO, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_PAN) {
 	    if (ym_pan > 0) ym_pan--;
-	    set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+	    sound_post(SOUND_PAN_AMS_FMS, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_AMS) {
 	    if (ym_ams > 0) ym_ams--;
-	    set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+	    sound_post(SOUND_PAN_AMS_FMS, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_FMS) {
 	    if (ym_fms > 0) ym_fms--;
-	    set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+	    sound_post(SOUND_PAN_AMS_FMS, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_OP) {
 	    if (ym_op > 0) ym_op--;
 	  } else if (ym_select_field == YM_FIELD_CHAN) {
 	    if (ym_chan > 0) ym_chan--;
+	  } else if (ym_select_field == YM_FIELD_GLIDE) {
+	    if (ym_glide > 0) ym_glide--;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_VIB_SPEED) {
+	    if (ym_vib_speed > 0) ym_vib_speed--;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_VIB_DEPTH) {
+	    if (ym_vib_depth > 0) ym_vib_depth--;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_BEND) {
+	    if (ym_bend > -YM_BEND_RANGE) ym_bend--;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_SSGEG) {
+	    if (ym_ssgeg[ym_chan * 4 + ym_op] > 0) ym_ssgeg[ym_chan * 4 + ym_op]--;
+	    sound_post(SOUND_SSGEG, ym_chan * 4 + ym_op);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_PATCH) {
+	    if (ym_patch > 0) {
+	      ym_patch--;
+	      if (ym_patch) {
+		load_ym_patch(ym_patch);
+		sound_post(SOUND_INSTRUMENT, 0);
+	      }
+	      savegame();
+	    }
+	  } else if (ym_select_field == YM_FIELD_LEGATO) {
+	    ym_legato = !ym_legato;
+	    sound_post(SOUND_LEGATO, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_ARP) {
+	    if (ym_arp > 0) ym_arp--;
+	    sound_post(SOUND_MACROS, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_PITCH_MACRO) {
+	    if (ym_pitch_macro > 0) ym_pitch_macro--;
+	    sound_post(SOUND_MACROS, 0);
+	    savegame();
 	  }
+	} else if (screen == SCREEN_YM3_SEQ) {
+
+	  disable_ints; // the sequencer must not play the note before it is compiled
+	  ym3Seq[selectstep].note[column]--;
+	  if (ym3Seq[selectstep].note[column] < -1) ym3Seq[selectstep].note[column] = -1;
+	  ym3_step_compile(&ym3Seq[selectstep]);
+	  enable_ints;
+	
+	  savegame();
+
+	  vdp_text_clear(VDP_PLAN_A, 6 + column * 3, STEP_ROW(selectstep), 2);
+	  sprintf(s, "%02d", ym3Seq[selectstep].note[column]);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));	  
 	} else if (screen == SCREEN_PROJECT) {
-	  if (tempo > 1) {
-	    tempo--;
+	  if (project_select_field == PROJECT_FIELD_TEMPO) {
+	    if (bpm >= BPM_MIN + 10) {
+	      bpm -= 10;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_CH3) {
+	    if (ym_ch3_special) {
+	      ym_ch3_special = 0;
+	      sound_post(SOUND_CH3_MODE, 0);
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_CLOCK) {
+	    if (seq_clock != SEQ_CLOCK_VSYNC) {
+	      seq_clock = SEQ_CLOCK_VSYNC;
+	      sound_post(SOUND_SEQ_CLOCK, 0);
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_TIMER_A) {
+	    if (timer_a_value > 0) {
+	      timer_a_value--;
+	      if (seq_clock == SEQ_CLOCK_TIMER_A) sound_post(SOUND_TIMER_A, 0);
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_BPM_FINE) {
+	    if (bpm > BPM_MIN) {
+	      bpm--;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_SONG_MODE) {
+	    if (songMode) {
+	      songMode = 0;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_SONG_LENGTH) {
+	    if (songLength > 1) {
+	      songLength--;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_SWING) {
+	    if (seq_swing > 0) {
+	      seq_swing--;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_GROOVE) {
+	    if (seq_groove > 0) {
+	      seq_groove--;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_RECORD) {
+	    recording = 0;
+	  } else if (project_select_field == PROJECT_FIELD_REC_TRIM) {
+	    if (recTrim > 0) {
+	      recTrim--;
+	      savegame();
+	    }
+	  } else if (project_select_field >= PROJECT_FIELD_RATE) {
+	    int t = project_select_field - PROJECT_FIELD_RATE;
+	    if (patternRate[t][editPattern[t]] > 0) {
+	      patternRate[t][editPattern[t]]--;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field >= PROJECT_FIELD_LENGTH) {
+	    int t = project_select_field - PROJECT_FIELD_LENGTH;
+	    if (patternLength[t][editPattern[t]] > 1) {
+	      patternLength[t][editPattern[t]]--;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field >= PROJECT_FIELD_PATTERN) {
+	    int t = project_select_field - PROJECT_FIELD_PATTERN;
+	    if (editPattern[t] > 0) {
+	      editPattern[t]--;
+	      if (bind_edit_patterns()) {
+		savegame();
+	      } else {
+		editPattern[t]++;
+		pattern_memory_full();
+	      }
+	    }
+	  }
+	} else if (screen == SCREEN_LOCKS) {
+	  lock_edit(-1);
+	} else if (screen == SCREEN_SONG) {
+	  if (song[selectstep][column] > 0) {
+	    song[selectstep][column]--;
+	    nextRowStale = 1;
+	    savegame();
+	  }
+
+	  sprintf(s, "%02d", song[selectstep][column]);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));
+	} else if (screen == SCREEN_PSG_INST) {
+	  psgenv_shape_t *shape = &psgenv_shapes[psg_track];
+	  if (psg_select_field == PSG_FIELD_TRACK) {
+	    if (psg_track > 0) psg_track--;
+	  } else if (psg_select_field == PSG_FIELD_ATTACK) {
+	    if (shape->attack > 0) shape->attack--;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_DECAY) {
+	    if (shape->decay > 0) shape->decay--;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_SUSTAIN) {
+	    if (shape->sustain > 0) shape->sustain--;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_RELEASE) {
+	    if (shape->release > 0) shape->release--;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_ARP) {
+	    if (shape->arp > 0) shape->arp--;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_PITCH) {
+	    if (shape->pitch > 0) shape->pitch--;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_NOISE) {
+	    if (shape->noise > 0) shape->noise--;
 	    savegame();
 	  }
 	}
@@ -1230,130 +3237,308 @@ int main() {
 	if (screen == SCREEN_PCM_SEQ) {
 	  if (column == 0) {
 
-	    gateseq[selectstep]++;
-	    if (gateseq[selectstep] > sampleMax) gateseq[selectstep] = sampleMax;
+	    if (pcmSeq[selectstep].sample < sampleMax) pcmSeq[selectstep].sample++;
 
 	    savegame();
 
-	    vdp_text_clear(VDP_PLAN_A, 6, selectstep, 2);
-	    sprintf(s, "%02d", gateseq[selectstep]);
-	    vdp_puts(VDP_PLAN_A, s, 6, selectstep);
+	    vdp_text_clear(VDP_PLAN_A, 6, STEP_ROW(selectstep), 2);
+	    sprintf(s, "%02d", pcmSeq[selectstep].sample);
+	    vdp_puts(VDP_PLAN_A, s, 6, STEP_ROW(selectstep));
 	    rightpressed = 1;
 	  } else if (column == 1) {
-	    accseq[selectstep]++;
-	    if (accseq[selectstep] > 1) accseq[selectstep] = 1;
+	    pcmSeq[selectstep].flags |= PCM_STEP_ACCENT;
 
 	    savegame();
 
-	    vdp_text_clear(VDP_PLAN_A, 9, selectstep, 2);
-	    sprintf(s, "%02d", accseq[selectstep]);
-	    vdp_puts(VDP_PLAN_A, s, 9, selectstep);
+	    vdp_text_clear(VDP_PLAN_A, 9, STEP_ROW(selectstep), 2);
+	    sprintf(s, "%02d", pcmSeq[selectstep].flags & PCM_STEP_ACCENT);
+	    vdp_puts(VDP_PLAN_A, s, 9, STEP_ROW(selectstep));
 
 	  }  else if (column == 2) {
 
-	    speedseq[selectstep]++;
-	    if (speedseq[selectstep] > 255) speedseq[selectstep] = 255;
+	    if (pcmSeq[selectstep].speed < 255) pcmSeq[selectstep].speed++;
 	
 	    savegame();
 
-	    vdp_text_clear(VDP_PLAN_A, 12, selectstep, 2);
-	    sprintf(s, "%02d", speedseq[selectstep]);
-	    vdp_puts(VDP_PLAN_A, s, 12, selectstep);      
+	    vdp_text_clear(VDP_PLAN_A, 12, STEP_ROW(selectstep), 2);
+	    sprintf(s, "%02d", pcmSeq[selectstep].speed);
+	    vdp_puts(VDP_PLAN_A, s, 12, STEP_ROW(selectstep));      
 	  
 	  }  
 	} else if (screen == SCREEN_PSG_SEQ) { // psg
 
-	  psgNoteSeq[selectstep]++;
+	  int8_t *lane = psg_lane(selectstep, column);
+	  int max = PSG_NOTE_COUNT;
+	  if (column & 1) {
+	    max = 15;
+	  } else if ((column >> 1) == PSG_NOISE_TRACK) {
+	    max = PSG_NOISE_MODES;
+	  }
+	  (*lane)++;
+	  if (*lane > max) *lane = max;
 	
 	  savegame();
 
-	  vdp_text_clear(VDP_PLAN_A, 6, selectstep, 2);
-	  sprintf(s, "%02d", psgNoteSeq[selectstep]);
-	  vdp_puts(VDP_PLAN_A, s, 6, selectstep);      	  
+	  vdp_text_clear(VDP_PLAN_A, 6 + column * 3, STEP_ROW(selectstep), 2);
+	  sprintf(s, "%02d", *lane);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));      	  
 	} else if (screen == SCREEN_YM_SEQ) {
 	  
-	  ymNoteSeq[selectstep]++;
+	  disable_ints; // the sequencer must not play the note before it is compiled
+	  ymSeq[selectstep].note[column]++;
+	  if (ymSeq[selectstep].note[column] > 107) ymSeq[selectstep].note[column] = 107;
+	  ym_step_compile(&ymSeq[selectstep]);
+	  enable_ints;
 	
 	  savegame();
 
-	  vdp_text_clear(VDP_PLAN_A, 6, selectstep, 2);
-	  sprintf(s, "%02d", ymNoteSeq[selectstep]);
-	  vdp_puts(VDP_PLAN_A, s, 6, selectstep);
+	  vdp_text_clear(VDP_PLAN_A, 6 + column * 3, STEP_ROW(selectstep), 2);
+	  sprintf(s, "%02d", ymSeq[selectstep].note[column]);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));
 	  
 	} else if (screen == SCREEN_YM_INST) { // ym instrument screen
 	  
 	  if (ym_select_field == YM_FIELD_LFO_ENABLE) {
 	    ym_lfo_enable = !ym_lfo_enable;
-	    set_ym_lfo(ym_lfo_enable, ym_lfo_speed);
+	    sound_post(SOUND_LFO, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_LFO_SPEED) {
 	    ym_lfo_speed++;
 	    if (ym_lfo_speed > 7) ym_lfo_speed = 7;
-	    set_ym_lfo(ym_lfo_enable, ym_lfo_speed);
+	    sound_post(SOUND_LFO, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_DETUNE) {
 	    ym_detune++;
 	    if (ym_detune > 7) ym_detune = 7;
-	    set_ym_detune_mult(ym_detune, ym_mult);
+	    sound_post(SOUND_DETUNE_MULT, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_MULT) {
 	    ym_mult++;
 	    if (ym_mult > 0x0F) ym_mult = 0x0F;
-	    set_ym_detune_mult(ym_detune, ym_mult);
+	    sound_post(SOUND_DETUNE_MULT, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_LEVEL) {
 	    if (ym_level[ym_chan * 4 + ym_op] < 0x7F) ym_level[ym_chan * 4 + ym_op]++;
-	    set_ym_level(ym_chan, ym_op, ym_level[ym_chan * 4 + ym_op]);
+	    sound_post(SOUND_LEVEL, ym_chan * 4 + ym_op);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_ATTACK) {
 	    if (ym_attack < 0x1F) ym_attack++;
-	    set_ym_attack(ym_attack);
+	    sound_post(SOUND_ATTACK, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_RELEASE) {
 	    if (ym_release < 0xF) ym_release++;
-	    set_ym_release_sustain(ym_release, ym_sustain);
+	    sound_post(SOUND_RELEASE_SUSTAIN, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_SUSTAIN) {
 	    if (ym_sustain < 0xF) ym_sustain++;
-	    set_ym_release_sustain(ym_release, ym_sustain);
+	    sound_post(SOUND_RELEASE_SUSTAIN, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_DECAY) {
 	    if (ym_decay < 0x1F) ym_decay++;
-	    set_ym_decay_am(ym_decay, ym_am);
+	    sound_post(SOUND_DECAY_AM, 0);
 	    savegame();	    
 	  } else if (ym_select_field == YM_FIELD_AM) {
 	    if (ym_am == 0) ym_am++;
-	    set_ym_decay_am(ym_decay, ym_am);
+	    sound_post(SOUND_DECAY_AM, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_FEEDBACK) {
 	    if (ym_feedback < 0x7) ym_feedback++;
-	    set_ym_feedback_algo(ym_feedback, ym_algo);
+	    sound_post(SOUND_FEEDBACK_ALGO, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_ALGO) {
 	    if (ym_algo < 7) ym_algo++;
-	    set_ym_feedback_algo(ym_feedback, ym_algo);
+	    sound_post(SOUND_FEEDBACK_ALGO, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_PAN) {
 	    if (ym_pan < 3) ym_pan++;
-	    set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+	    sound_post(SOUND_PAN_AMS_FMS, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_AMS) {
 	    if (ym_ams < 3) ym_ams++;
-	    set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+	    sound_post(SOUND_PAN_AMS_FMS, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_FMS) {
 	    if (ym_fms < 7) ym_fms++;
-	    set_ym_pan_ams_fms(ym_pan, ym_ams, ym_fms);
+	    sound_post(SOUND_PAN_AMS_FMS, 0);
 	    savegame();
 	  } else if (ym_select_field == YM_FIELD_OP) {
 	    if (ym_op < 3) ym_op++;
 	  } else if (ym_select_field == YM_FIELD_CHAN) {
 	    if (ym_chan < 5) ym_chan++;
+	  } else if (ym_select_field == YM_FIELD_GLIDE) {
+	    if (ym_glide < YM_GLIDE_MAX) ym_glide++;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_VIB_SPEED) {
+	    if (ym_vib_speed < YM_VIB_SPEED_MAX) ym_vib_speed++;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_VIB_DEPTH) {
+	    if (ym_vib_depth < YM_VIB_DEPTH_MAX) ym_vib_depth++;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_BEND) {
+	    if (ym_bend < YM_BEND_RANGE) ym_bend++;
+	    sound_post(SOUND_PITCH_MOD, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_SSGEG) {
+	    if (ym_ssgeg[ym_chan * 4 + ym_op] < YM_SSGEG_MAX) ym_ssgeg[ym_chan * 4 + ym_op]++;
+	    sound_post(SOUND_SSGEG, ym_chan * 4 + ym_op);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_PATCH) {
+	    if (ym_patch < YM_PATCH_COUNT) {
+	      ym_patch++;
+	      load_ym_patch(ym_patch);
+	      sound_post(SOUND_INSTRUMENT, 0);
+	      savegame();
+	    }
+	  } else if (ym_select_field == YM_FIELD_LEGATO) {
+	    ym_legato = !ym_legato;
+	    sound_post(SOUND_LEGATO, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_ARP) {
+	    if (ym_arp < MACRO_BANK_SIZE - 1) ym_arp++;
+	    sound_post(SOUND_MACROS, 0);
+	    savegame();
+	  } else if (ym_select_field == YM_FIELD_PITCH_MACRO) {
+	    if (ym_pitch_macro < MACRO_BANK_SIZE - 1) ym_pitch_macro++;
+	    sound_post(SOUND_MACROS, 0);
+	    savegame();
 	  }
+	} else if (screen == SCREEN_YM3_SEQ) {
+	  
+	  disable_ints; // the sequencer must not play the note before it is compiled
+	  ym3Seq[selectstep].note[column]++;
+	  if (ym3Seq[selectstep].note[column] > 107) ym3Seq[selectstep].note[column] = 107;
+	  ym3_step_compile(&ym3Seq[selectstep]);
+	  enable_ints;
+	
+	  savegame();
+
+	  vdp_text_clear(VDP_PLAN_A, 6 + column * 3, STEP_ROW(selectstep), 2);
+	  sprintf(s, "%02d", ym3Seq[selectstep].note[column]);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));
+	  
 	} else if (screen == SCREEN_PROJECT) {
-	  if (tempo < 255) {
-	    tempo++;
-	    savegame();	    
+	  if (project_select_field == PROJECT_FIELD_TEMPO) {
+	    if (bpm <= BPM_MAX - 10) {
+	      bpm += 10;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_CH3) {
+	    if (!ym_ch3_special) {
+	      ym_ch3_special = 1;
+	      sound_post(SOUND_CH3_MODE, 0);
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_CLOCK) {
+	    if (seq_clock != SEQ_CLOCK_TIMER_A) {
+	      seq_clock = SEQ_CLOCK_TIMER_A;
+	      sound_post(SOUND_SEQ_CLOCK, 0);
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_TIMER_A) {
+	    if (timer_a_value < 1023) {
+	      timer_a_value++;
+	      if (seq_clock == SEQ_CLOCK_TIMER_A) sound_post(SOUND_TIMER_A, 0);
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_BPM_FINE) {
+	    if (bpm < BPM_MAX) {
+	      bpm++;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_SONG_MODE) {
+	    if (!songMode) {
+	      songMode = 1;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_SONG_LENGTH) {
+	    if (songLength < SONG_LENGTH_MAX) {
+	      songLength++;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_SWING) {
+	    if (seq_swing < SWING_MAX) {
+	      seq_swing++;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_GROOVE) {
+	    if (seq_groove < GROOVE_COUNT - 1) {
+	      seq_groove++;
+	      savegame();
+	    }
+	  } else if (project_select_field == PROJECT_FIELD_RECORD) {
+	    recording = 1;
+	  } else if (project_select_field == PROJECT_FIELD_REC_TRIM) {
+	    if (recTrim < REC_TRIM_MAX) {
+	      recTrim++;
+	      savegame();
+	    }
+	  } else if (project_select_field >= PROJECT_FIELD_RATE) {
+	    int t = project_select_field - PROJECT_FIELD_RATE;
+	    if (patternRate[t][editPattern[t]] < RATE_COUNT - 1) {
+	      patternRate[t][editPattern[t]]++;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field >= PROJECT_FIELD_LENGTH) {
+	    int t = project_select_field - PROJECT_FIELD_LENGTH;
+	    if (patternLength[t][editPattern[t]] < PATTERN_STEPS_MAX) {
+	      patternLength[t][editPattern[t]]++;
+	      nextRowStale = 1;
+	      savegame();
+	    }
+	  } else if (project_select_field >= PROJECT_FIELD_PATTERN) {
+	    int t = project_select_field - PROJECT_FIELD_PATTERN;
+	    if (editPattern[t] < PATTERN_COUNT - 1) {
+	      editPattern[t]++;
+	      if (bind_edit_patterns()) {
+		savegame();
+	      } else {
+		editPattern[t]--;
+		pattern_memory_full();
+	      }
+	    }
+	  }
+	} else if (screen == SCREEN_LOCKS) {
+	  lock_edit(1);
+	} else if (screen == SCREEN_SONG) {
+	  if (song[selectstep][column] < PATTERN_COUNT - 1) {
+	    song[selectstep][column]++;
+	    nextRowStale = 1;
+	    savegame();
+	  }
+
+	  sprintf(s, "%02d", song[selectstep][column]);
+	  vdp_puts(VDP_PLAN_A, s, 6 + column * 3, STEP_ROW(selectstep));
+	} else if (screen == SCREEN_PSG_INST) {
+	  psgenv_shape_t *shape = &psgenv_shapes[psg_track];
+	  if (psg_select_field == PSG_FIELD_TRACK) {
+	    if (psg_track < PSG_TRACK_COUNT - 1) psg_track++;
+	  } else if (psg_select_field == PSG_FIELD_ATTACK) {
+	    if (shape->attack < PSG_ENV_RATE_MAX) shape->attack++;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_DECAY) {
+	    if (shape->decay < PSG_ENV_RATE_MAX) shape->decay++;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_SUSTAIN) {
+	    if (shape->sustain < PSG_ENV_LEVEL_MAX) shape->sustain++;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_RELEASE) {
+	    if (shape->release < PSG_ENV_RATE_MAX) shape->release++;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_ARP) {
+	    if (shape->arp < MACRO_BANK_SIZE - 1) shape->arp++;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_PITCH) {
+	    if (shape->pitch < MACRO_BANK_SIZE - 1) shape->pitch++;
+	    savegame();
+	  } else if (psg_select_field == PSG_FIELD_NOISE) {
+	    if (shape->noise < MACRO_BANK_SIZE - 1) shape->noise++;
+	    savegame();
 	  }
 	}
 
@@ -1366,24 +3551,28 @@ int main() {
     // check if A was pressed
     if (player1_state.a) {
       if (!apressed) {
-	if (screen == SCREEN_PCM_SEQ) { // pcm
+	if (recording && playing && screen_track() >= 0 &&
+	    !player1_state.down && !player1_state.up) { // not the play or fill combos
+	  record_hit();
+	} else if (screen == SCREEN_PCM_SEQ) { // pcm
 	  column = (column + 1) % COLUMN_COUNT;
-	  if (column == 1) {
-	    vdp_text_clear(VDP_PLAN_A, 5, selectstep, 1);
-	    vdp_text_clear(VDP_PLAN_A, 8, selectstep, 1);      
-	    vdp_puts(VDP_PLAN_A, ">", 8, selectstep);
-	    vdp_puts(VDP_PLAN_A, "<", 11, selectstep);            
-	  } else if (column == 0) {
-	    vdp_text_clear(VDP_PLAN_A, 11, selectstep, 1);
-	    vdp_text_clear(VDP_PLAN_A, 14, selectstep, 1);      
-	    vdp_puts(VDP_PLAN_A, ">", 5, selectstep);
-	    vdp_puts(VDP_PLAN_A, "<", 8, selectstep);            
-	  } else if (column == 2) {
-	    vdp_text_clear(VDP_PLAN_A, 8, selectstep, 1);
-	    vdp_text_clear(VDP_PLAN_A, 11, selectstep, 1);      
-	    vdp_puts(VDP_PLAN_A, ">", 11, selectstep);
-	    vdp_puts(VDP_PLAN_A, "<", 14, selectstep);
-	  }
+	  moveColumnCursor(oldcolumn, column, STEP_ROW(selectstep));
+	  oldcolumn = column;
+	} else if (screen == SCREEN_PSG_SEQ) { // psg note and volume lanes
+	  column = (column + 1) % PSG_COLUMN_COUNT;
+	  moveColumnCursor(oldcolumn, column, STEP_ROW(selectstep));
+	  oldcolumn = column;
+	} else if (screen == SCREEN_YM_SEQ) { // ym chord lanes
+	  column = (column + 1) % YM_CHORD_MAX;
+	  moveColumnCursor(oldcolumn, column, STEP_ROW(selectstep));
+	  oldcolumn = column;
+	} else if (screen == SCREEN_YM3_SEQ) { // channel 3 operator lanes
+	  column = (column + 1) % YM3_OP_COUNT;
+	  moveColumnCursor(oldcolumn, column, STEP_ROW(selectstep));
+	  oldcolumn = column;
+	} else if (screen == SCREEN_SONG) { // one pattern per track
+	  column = (column + 1) % TRACK_COUNT;
+	  moveColumnCursor(oldcolumn, column, STEP_ROW(selectstep));
 	  oldcolumn = column;
 	}
 	apressed = 1;
@@ -1402,20 +3591,31 @@ int main() {
       bpressed = 0;
     }    
 
+    // check if start was pressed
+    if (player1_state.start) {
+      if (!startpressed) {
+	panic();
+      }
+      startpressed = 1;
+    } else {
+      startpressed = 0;
+    }
+
     // check if C was pressed - doesn't work some reason
     if (apressed && downpressed) {
       // need to change playing once and set something so it can't be changed
       // until one of the buttons is released
       if (playingCanChange) {
-	playing = !playing;
-	if (playing) {
-	  vdp_text_clear(VDP_PLAN_A, 3, 18, 40);
-	  vdp_puts(VDP_PLAN_A, "playing", 3, 18);
+	if (!playing) {
+	  // the handler rewinds to the first row before it starts
+	  sound_post(SOUND_START, 0);
+	  vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+	  vdp_puts(VDP_PLAN_A, "playing", 3, STATUS_ROW);
 	} else {
-	  vdp_text_clear(VDP_PLAN_A, 3, 18, 40);
-	  vdp_puts(VDP_PLAN_A, "stopped", 3, 18);
-	  stop_sample(); // stop any playing
-	  psg_setEnvelope(0, 15);	  
+	  sound_post(SOUND_STOP, 0);
+	  if (saveIdle) savegame_write();
+	  vdp_text_clear(VDP_PLAN_A, 3, STATUS_ROW, 40);
+	  vdp_puts(VDP_PLAN_A, "stopped", 3, STATUS_ROW);
 	}
 	playingCanChange = 0;
       }
@@ -1423,6 +3623,9 @@ int main() {
     } else {
       playingCanChange = 1;
     }
+
+    // A and up held together play the fills
+    fillMode = apressed && uppressed;
     
     if (screen == SCREEN_PCM_SEQ) {
       displayPCMScreen();
@@ -1430,128 +3633,23 @@ int main() {
       displayPSGScreen();
     } else if (screen == SCREEN_YM_SEQ) {
       displayYMScreen();
+    } else if (screen == SCREEN_YM3_SEQ) {
+      displayYM3Screen();
     } else if (screen == SCREEN_YM_INST) {
       displayYMInstScreen();
     } else if (screen == SCREEN_PROJECT) {
       displayProjectScreen();
+    } else if (screen == SCREEN_PSG_INST) {
+      displayPSGInstScreen();
+    } else if (screen == SCREEN_SONG) {
+      displaySongScreen();
+    } else if (screen == SCREEN_LOCKS) {
+      displayLockScreen();
     }
     oldscreen = screen;
 
-    // check if we need to update the sequencer
-    //    if (frame % framemod == 0) {
-    if (frame % tempo == 0) {    
-
-      if (playing) {
-
-	/* psg sequencer */
-	if (psgNoteSeq[seqpos]) {
-	  int note = psgNoteSeq[seqpos] - 1;
-	  int octave = 0;
-	  if (note > 11 && note < 24) {
-	    note -= 12;
-	    octave++;
-	  } else if (note >= 24 && note < 36) {
-	    note -= 24;
-	    octave += 2;
-	  } else if (note >= 36 && note < 48) {
-	    note -= 36;
-	    octave += 3;
-	  } else if (note >= 48 && note < 60) {
-	    note -= 48;
-	    octave += 4;
-	  } else if (note >= 60) {
-	    note -= 60;
-	    octave += 5;
-	  }
-	  int counterVal = midiNoteToPSGCounter[note];
-	  if (octave == 1) {
-	    counterVal /= 2;
-	  } else if (octave == 2) {
-	    counterVal /= 4;
-	  } else if (octave == 3) {
-	    counterVal /= 8;
-	  } else if (octave == 4) {
-	    counterVal /= 16;
-	  } else if (octave == 5) {
-	    counterVal /= 32;
-	  }
-	  psg_setTone(0, counterVal);
-	  psg_setEnvelope(0, 5);	  
-	} else {
-	  psg_setEnvelope(0, 15);	  	  
-	}
-
-	/* ym sequencer */	
-	if (ymNoteSeq[seqpos] > 0) {
-	  Z80_requestBus(1);
-	  noteoff_chan0();
-	  ym_set_pitch_ch0(ymNoteSeq[seqpos]);
-	  noteon_chan0();
-	  YM2612_latchDacDataReg();
-	  Z80_releaseBus();
-	} else if (ymNoteSeq[seqpos] == -1) {
-	  Z80_requestBus(1);
-	  noteoff_chan0();
-	  YM2612_latchDacDataReg();
-	  Z80_releaseBus();
-	}
-
-	/* pcm sequencer */
-	if (gateseq[seqpos]) { // do we need to play a sample?
-	  
-	  stop_sample(); // stop any playing first
-	  
-	  if (accseq[seqpos] == 1) {
-	    set_accent(1); // set the accent
-	  } else {
-	    set_accent(0);
-	  }
-	  if (gateseq[seqpos] == 1) { // play sample 1 - clap
-	    set_sample_start(0);
-	    set_sample_length(659);
-	  } else if (gateseq[seqpos] == 2) { // play sample 2 - cymbal
-	    set_sample_start(659);
-	    set_sample_length(7761);
-	  } else if (gateseq[seqpos] == 3) { // play sample 3 - hat closed
-	    set_sample_start(659+7761);
-	    set_sample_length(863);
-	  } else if (gateseq[seqpos] == 4) { // play sample 4 - hat open
-	    set_sample_start(659+7761+863);
-	    set_sample_length(4299);
-	  } else if (gateseq[seqpos] == 5) { // play sample 5 - kick
-	    set_sample_start(659+7761+863+4299);
-	    set_sample_length(662);
-	  } else if (gateseq[seqpos] == 6) { // play sample 6 - snare
-	    set_sample_start(659+7761+863+4299+662);
-	    set_sample_length(1058);
-	  } else if (gateseq[seqpos] == 7) { // play sample 7 - tom high
-	    set_sample_start(659+7761+863+4299+662+1058);
-	    set_sample_length(1585);
-	  } else if (gateseq[seqpos] == 8) { // play sample 8 - tom low
-	    set_sample_start(659+7761+863+4299+662+1058+1585);
-	    set_sample_length(1585);
-	  } else if (gateseq[seqpos] == 9) { // play sample 9 - tom mid
-	    set_sample_start(659+7761+863+4299+662+1058+1585+1585);
-	    set_sample_length(1607);
-	  }
-	  set_dacSpeed(speedseq[seqpos]); // set the playback speed
-	  play_sample();
-	} else {
-	  // we have to stop the sample if it's not set every step or we hear noise.
-	  // didn't happen until I added the ym code
-//	  stop_sample();
-	}
-	seqpos = (seqpos + 1) % 16;
-	
-      }
-    }    
-
-    Z80_requestBus(1);
-    uint8_t color = Z80_read(outputValue_addr);
-    Z80_releaseBus();  
-
     //    vdp_color(0, color);
-    color = color >> 4;
+    uint8_t color = meterLevel >> 4;
     for (int i=0; i<38; i++) {
       if (i <= color) {
 	vdp_map_xy(VDP_PLAN_A, 101, i+1, 26);
@@ -1560,8 +3658,14 @@ int main() {
       }
     }
 
+    if (saveIdle && !--saveIdle) savegame_write();
+
+    // timer A is polled from the horizontal interrupt
+    if (seq_clock != hint_clock) {
+      hint_clock = seq_clock;
+      vdp_set_hint(hint_clock == SEQ_CLOCK_TIMER_A ? TIMER_POLL_LINES : 0);
+    }
     vdp_vsync();
-    frame++;
   }
 	
   return 0;
@@ -9,5 +9,5 @@
                              "move.l (0),%a7\n\t"     \
                              "jmp    _hard_reset")
 
-#define enable_ints __asm__("move #0x2500,%sr")
-#define disable_ints __asm__("move #0x2700,%sr")
+#define enable_ints __asm__ __volatile__("move #0x2300,%%sr" ::: "memory")
+#define disable_ints __asm__ __volatile__("move #0x2700,%%sr" ::: "memory")
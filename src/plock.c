@@ -0,0 +1,93 @@
+#include "plock.h"
+#include "trig.h"
+
+static const uint8_t plockMin[PLOCK_PARAM_COUNT] = {0, 0, 0, 0, 0, 1, 1, 1, 1};
+static const uint8_t plockMax[PLOCK_PARAM_COUNT] = {
+  127, 127, 127, 127, 7, 15, 255, 23, TRIG_COND_COUNT - 1
+};
+
+static const char *const plockNames[PLOCK_PARAM_COUNT] = {
+  "tl op1  ", "tl op2  ", "tl op3  ", "tl op4  ", "feedback", "volume  ", "rate    ",
+  "nudge   ", "trig    "
+};
+
+void plock_clear(plock_list_t *list) {
+  list->count = 0;
+}
+
+// index of the lock, or of where it would go to keep the list sorted
+static uint8_t plock_index(const plock_list_t *list, uint8_t step, uint8_t param) {
+  uint8_t i = 0;
+
+  while (i < list->count) {
+    const plock_t *l = &list->lock[i];
+    if (l->step > step || (l->step == step && l->param >= param)) break;
+    i++;
+  }
+  return i;
+}
+
+int16_t plock_get(const plock_list_t *list, uint8_t step, uint8_t param) {
+  uint8_t i = plock_index(list, step, param);
+
+  if (i < list->count && list->lock[i].step == step && list->lock[i].param == param) {
+    return list->lock[i].value;
+  }
+  return -1;
+}
+
+uint8_t plock_set(plock_list_t *list, uint8_t step, uint8_t param, uint8_t value) {
+  uint8_t i = plock_index(list, step, param);
+
+  if (i < list->count && list->lock[i].step == step && list->lock[i].param == param) {
+    list->lock[i].value = value;
+    return 1;
+  }
+  if (list->count >= PLOCK_MAX) return 0;
+
+  for (uint8_t j = list->count; j > i; j--) {
+    list->lock[j] = list->lock[j - 1];
+  }
+  list->lock[i].step = step;
+  list->lock[i].param = param;
+  list->lock[i].value = value;
+  list->count++;
+  return 1;
+}
+
+void plock_remove(plock_list_t *list, uint8_t step, uint8_t param) {
+  uint8_t i = plock_index(list, step, param);
+
+  if (i >= list->count || list->lock[i].step != step || list->lock[i].param != param) return;
+
+  list->count--;
+  for (; i < list->count; i++) {
+    list->lock[i] = list->lock[i + 1];
+  }
+}
+
+// stops at the first lock past the step, so a step costs at most one pass
+// over the locks before it
+void plock_step(const plock_list_t *list, uint8_t step, plock_step_t *out) {
+  out->mask = 0;
+  for (uint8_t i = 0; i < list->count; i++) {
+    const plock_t *l = &list->lock[i];
+    if (l->step > step) break;
+    if (l->step == step) {
+      out->mask |= 1 << l->param;
+      out->value[l->param] = l->value;
+    }
+  }
+}
+
+uint8_t plock_min(uint8_t param) {
+  return plockMin[param];
+}
+
+uint8_t plock_max(uint8_t param) {
+  return plockMax[param];
+}
+
+const char *plock_name(uint8_t param) {
+  return plockNames[param];
+}
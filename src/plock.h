@@ -0,0 +1,49 @@
+#ifndef H_PLOCK
+#define H_PLOCK
+
+#include <stdint.h>
+
+// parameter locks: a value that replaces an instrument setting for the notes
+// of one step. each pattern keeps a short list sorted by step, since most
+// steps have no locks at all
+#define PLOCK_MAX 16 // per pattern
+
+#define PLOCK_TL 0       // 0-3, total level of operators 1-4, fm tracks
+#define PLOCK_FEEDBACK 4 // fm tracks
+#define PLOCK_VOLUME 5   // psg track, every note started on the step
+#define PLOCK_RATE 6     // pcm track, sample playback speed
+#define PLOCK_NUDGE 7    // any track, clock ticks the track plays late
+#define PLOCK_COND 8     // any track, trig condition, see trig.h
+#define PLOCK_PARAM_COUNT 9
+
+typedef struct {
+  uint8_t step;
+  uint8_t param;
+  uint8_t value;
+} plock_t;
+
+typedef struct {
+  uint8_t count;
+  plock_t lock[PLOCK_MAX];
+} plock_list_t;
+
+// every lock of one step, bit n of mask set when param n is locked
+typedef struct {
+  uint16_t mask;
+  uint8_t value[PLOCK_PARAM_COUNT];
+} plock_step_t;
+
+void plock_clear(plock_list_t *list);
+// the locked value, -1 when the param isn't locked on that step
+int16_t plock_get(const plock_list_t *list, uint8_t step, uint8_t param);
+// add or change a lock, 0 when the list is full
+uint8_t plock_set(plock_list_t *list, uint8_t step, uint8_t param, uint8_t value);
+void plock_remove(plock_list_t *list, uint8_t step, uint8_t param);
+// the locks of a step, for the sequencer
+void plock_step(const plock_list_t *list, uint8_t step, plock_step_t *out);
+
+uint8_t plock_min(uint8_t param);
+uint8_t plock_max(uint8_t param);
+const char *plock_name(uint8_t param);
+
+#endif
@@ -0,0 +1,51 @@
+#include "pool.h"
+
+static uint8_t arena[ARENA_SIZE] __attribute__((aligned(2)));
+static uint16_t arenaUsed = 0;
+
+void *arena_alloc(uint16_t size) {
+  void *p;
+
+  size = (size + 1) & ~1; // keeps every allocation word aligned
+  if (size > ARENA_SIZE - arenaUsed) return 0;
+  p = &arena[arenaUsed];
+  arenaUsed += size;
+  return p;
+}
+
+uint16_t arena_left() {
+  return ARENA_SIZE - arenaUsed;
+}
+
+uint8_t pool_init(pool_t *pool, uint16_t size, uint8_t count) {
+  if (size < sizeof(void *)) size = sizeof(void *);
+  size = (size + 1) & ~1;
+  pool->mem = arena_alloc(size * count);
+  pool->size = size;
+  pool->count = pool->mem ? count : 0;
+  pool->used = 0;
+  pool->free = 0;
+
+  // thread the free list back to front, so blocks are handed out in order
+  for (uint8_t i = pool->count; i > 0; i--) {
+    void **block = (void **)(pool->mem + (uint16_t)(i - 1) * size);
+    *block = pool->free;
+    pool->free = block;
+  }
+  return pool->count == count;
+}
+
+void *pool_alloc(pool_t *pool) {
+  void **block = pool->free;
+
+  if (!block) return 0;
+  pool->free = *block;
+  pool->used++;
+  return block;
+}
+
+void pool_free(pool_t *pool, void *block) {
+  *(void **)block = pool->free;
+  pool->free = block;
+  pool->used--;
+}
@@ -0,0 +1,31 @@
+#ifndef H_POOL
+#define H_POOL
+
+#include <stdint.h>
+
+// work ram for the pattern data: one arena handed out at start up, then
+// pools of fixed size blocks carved from it. blocks go back to their pool,
+// the arena itself is never freed
+#define ARENA_SIZE 17000 // the pattern pools and blank patterns of main.c
+// arena bytes a pool of count blocks takes, rounded like pool_init does
+#define POOL_BYTES(size, count) \
+  ((((size) < sizeof(void *) ? sizeof(void *) : (size)) + 1) / 2 * 2 * (count))
+
+void *arena_alloc(uint16_t size); // 0 when the arena is full
+uint16_t arena_left();
+
+typedef struct {
+  uint8_t *mem;
+  void *free;    // first free block, a free block starts with a pointer to the next
+  uint16_t size; // bytes per block, rounded up to even
+  uint8_t count;
+  uint8_t used;
+} pool_t;
+
+// 0 when the arena has no room for the blocks
+uint8_t pool_init(pool_t *pool, uint16_t size, uint8_t count);
+// a block with whatever it held before, 0 when every block is in use
+void *pool_alloc(pool_t *pool);
+void pool_free(pool_t *pool, void *block);
+
+#endif
@@ -1,21 +1,37 @@
 #include <stdint.h>
 #include "psg.h"
-
-const uint16_t midiNoteToPSGCounter[12] = {
-  851,
-  803,
-  758,
-  715,
-  675,
-  637,
-  601,
-  568,
-  536,
-  506,
-  477,
-  450
+#include "vdp.h"
+
+// tone counter for a frequency in millihertz, rounded to nearest
+#define PSG_COUNTER(clock, mhz) ((uint16_t)(((clock) * 1000ULL / 16 / (mhz) + 1) / 2))
+
+// one equal tempered octave from C, oct octaves above C3
+#define PSG_OCTAVE(clock, oct)						\
+  PSG_COUNTER(clock, 130813ULL << (oct)), PSG_COUNTER(clock, 138591ULL << (oct)), \
+  PSG_COUNTER(clock, 146832ULL << (oct)), PSG_COUNTER(clock, 155563ULL << (oct)), \
+  PSG_COUNTER(clock, 164814ULL << (oct)), PSG_COUNTER(clock, 174614ULL << (oct)), \
+  PSG_COUNTER(clock, 184997ULL << (oct)), PSG_COUNTER(clock, 195998ULL << (oct)), \
+  PSG_COUNTER(clock, 207652ULL << (oct)), PSG_COUNTER(clock, 220000ULL << (oct)), \
+  PSG_COUNTER(clock, 233082ULL << (oct)), PSG_COUNTER(clock, 246942ULL << (oct))
+
+// every sequencer note from C3 (855, the lowest C a 10 bit counter reaches)
+// up to B8, worked out by the compiler for both psg clocks
+const uint16_t psgNoteCounter[2][PSG_NOTE_COUNT] = {
+  { PSG_OCTAVE(PSG_CLOCK_NTSC, 0), PSG_OCTAVE(PSG_CLOCK_NTSC, 1), PSG_OCTAVE(PSG_CLOCK_NTSC, 2),
+    PSG_OCTAVE(PSG_CLOCK_NTSC, 3), PSG_OCTAVE(PSG_CLOCK_NTSC, 4), PSG_OCTAVE(PSG_CLOCK_NTSC, 5) },
+  { PSG_OCTAVE(PSG_CLOCK_PAL, 0), PSG_OCTAVE(PSG_CLOCK_PAL, 1), PSG_OCTAVE(PSG_CLOCK_PAL, 2),
+    PSG_OCTAVE(PSG_CLOCK_PAL, 3), PSG_OCTAVE(PSG_CLOCK_PAL, 4), PSG_OCTAVE(PSG_CLOCK_PAL, 5) }
 };
 
+uint16_t psgToneShadow[3];
+uint8_t psgEnvelopeShadow[4];
+
+// note 0 is C3, notes past the top of the table play the top note
+uint16_t psg_note_counter(uint8_t note) {
+  if (note >= PSG_NOTE_COUNT) note = PSG_NOTE_COUNT - 1;
+  return psgNoteCounter[pal_mode][note];
+}
+
 void psg_reset() {
 
   volatile uint8_t *pb;
@@ -31,6 +47,9 @@ void psg_reset() {
 
         // set envelope to silent
         *pb = 0x90 | (i << 5) | 0x0F;
+
+        if (i < 3) psgToneShadow[i] = 0;
+        psgEnvelopeShadow[i] = 0x0F;
     }  
 }
 
@@ -46,8 +65,13 @@ void psg_setEnvelope(uint8_t channel, uint8_t value) {
 
   volatile uint8_t *pb;
 
+  channel &= 3;
+  value &= 0xF;
+  if (psgEnvelopeShadow[channel] == value) return;
+  psgEnvelopeShadow[channel] = value;
+
   pb = (uint8_t*) PSG_PORT;
-  *pb = 0x90 | ((channel & 3) << 5) | (value & 0xF);  
+  *pb = 0x90 | (channel << 5) | value;  
 }
 
 void psg_setTone(uint8_t channel, uint16_t frequency_value) {
@@ -62,21 +86,33 @@ void psg_setTone(uint8_t channel, uint16_t frequency_value) {
   //if (channel > 2 || frequency_value > 0x3FF) {
   //        return;
   //    }
+
+  uint16_t old = psgToneShadow[channel];
+
+  frequency_value &= 0x3FF;
+  if (old == frequency_value) return;
+  psgToneShadow[channel] = frequency_value;
     
     // 1. Latch tone register and write low 4 bits: %1cctdddd (c=channel, t=type 0 for tone, d=data)
   uint8_t latch_byte = 0x80;
   latch_byte |= channel << 5;
   latch_byte |= frequency_value & 0x0f;
   psg_write(latch_byte);
-  // 2. Write the high 6 bits (only low 6 bits of the byte are used, high two bits are 0)
-  uint8_t data_byte = (frequency_value >> 4) & 0x3F; // Mask to 6 relevant bits
-  psg_write(data_byte);
+  // 2. Write the high 6 bits (only low 6 bits of the byte are used, high two bits are 0).
+  // the latch byte already updates the low bits, so small moves like vibrato
+  // usually need just the one byte
+  if ((old ^ frequency_value) & 0x3F0) {
+    uint8_t data_byte = (frequency_value >> 4) & 0x3F; // Mask to 6 relevant bits
+    psg_write(data_byte);
+  }
 }
 
 void psg_setToneLow(uint8_t channel, uint8_t value) {
 
   volatile uint8_t *pb;
 
+  psgToneShadow[channel] = (psgToneShadow[channel] & 0x3F0) | (value & 0xF);
+
   pb = (uint8_t*) PSG_PORT;
   *pb = 0x80 | ((channel & 3) << 5) | (value & 0xF);  
 }
@@ -88,14 +124,15 @@ void psg_setFrequency(uint8_t channel, uint8_t value) {
   if (value)
     {
       // frequency to tone conversion
-      if (IS_PAL_SYSTEM) data = 3546893 / (value * 32);
-      else data = 3579545 / (value * 32);
+      if (IS_PAL_SYSTEM) data = PSG_CLOCK_PAL / (value * 32);
+      else data = PSG_CLOCK_NTSC / (value * 32);
     }
   else data = 0;
 
   psg_setTone(channel, data);  
 }
 
+// always written, the write restarts the noise shift register
 void psg_setNoise(uint8_t type, uint8_t frequency) {
 
   volatile uint8_t *pb;
@@ -1,6 +1,8 @@
 #ifndef H_PSG
 #define H_PSG
 
+#include <stdint.h>
+
 #define PSG_PORT 0xC00011
 #define PSG_ENVELOPE_MIN 15
 #define PSG_ENVELOPE_MAX 0
@@ -11,8 +13,18 @@
 #define PSG_NOISE_FREQ_CLOCK8   2
 #define PSG_NOISE_FREQ_TONE3    3
 #define IS_PAL_SYSTEM 0
+#define PSG_CLOCK_NTSC 3579545
+#define PSG_CLOCK_PAL 3546893
+#define PSG_NOTE_COUNT 72 // C3 to B8
+
+extern const uint16_t psgNoteCounter[2][PSG_NOTE_COUNT];
+
+uint16_t psg_note_counter(uint8_t note);
 
-extern const uint16_t midiNoteToPSGCounter[12];
+// tone counters and attenuations last written, psg_setTone and
+// psg_setEnvelope skip writes that would not change anything
+extern uint16_t psgToneShadow[3];
+extern uint8_t psgEnvelopeShadow[4];
 
 void psg_reset();
 void psg_write(uint8_t data);
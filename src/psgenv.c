@@ -0,0 +1,162 @@
+#include "psgenv.h"
+#include "psg.h"
+#include "macro.h"
+
+#define ENV_OFF 0
+#define ENV_ATTACK 1
+#define ENV_DECAY 2
+#define ENV_SUSTAIN 3
+#define ENV_RELEASE 4
+
+// levels are kept in 1/16 steps so slow rates still move every frame
+#define ENV_SCALE 16
+
+typedef struct {
+  uint8_t phase;
+  uint8_t level; // 0 to volume * ENV_SCALE
+  uint8_t peak;  // note volume * ENV_SCALE
+  uint8_t hold;  // sustain level * ENV_SCALE
+  uint8_t note;  // note, or noise mode on the noise channel
+  uint8_t mode;  // noise mode last written, noise channel only
+  int16_t bend;  // sum of the pitch macro so far, in counter steps
+  macro_t arp;
+  macro_t pitch;
+  macro_t noise;
+} psgenv_state_t;
+
+psgenv_shape_t psgenv_shapes[PSG_ENV_CHANNELS] = {
+  {0, 0, 15, 0, 0, 0, 0}, {0, 0, 15, 0, 0, 0, 0},
+  {0, 0, 15, 0, 0, 0, 0}, {0, 0, 15, 0, 0, 0, 0}
+};
+
+static psgenv_state_t envs[PSG_ENV_CHANNELS];
+
+// level change per frame for each rate, rate 0 covers the whole range at once
+static const uint8_t envStep[PSG_ENV_RATE_MAX + 1] = {
+  240, 120, 80, 60, 40, 30, 24, 20, 16, 12, 10, 8, 6, 4, 2, 1
+};
+
+// sustain level for a note volume and a sustain setting, saves a divide per note
+#define HOLD(v, s) ((v) * ENV_SCALE * (s) / PSG_ENV_LEVEL_MAX)
+#define HOLD_ROW(v)							\
+  { HOLD(v, 0), HOLD(v, 1), HOLD(v, 2), HOLD(v, 3), HOLD(v, 4), HOLD(v, 5), \
+    HOLD(v, 6), HOLD(v, 7), HOLD(v, 8), HOLD(v, 9), HOLD(v, 10), HOLD(v, 11), \
+    HOLD(v, 12), HOLD(v, 13), HOLD(v, 14), HOLD(v, 15) }
+static const uint8_t envHold[PSG_ENV_LEVEL_MAX + 1][PSG_ENV_LEVEL_MAX + 1] = {
+  HOLD_ROW(0), HOLD_ROW(1), HOLD_ROW(2), HOLD_ROW(3), HOLD_ROW(4), HOLD_ROW(5),
+  HOLD_ROW(6), HOLD_ROW(7), HOLD_ROW(8), HOLD_ROW(9), HOLD_ROW(10), HOLD_ROW(11),
+  HOLD_ROW(12), HOLD_ROW(13), HOLD_ROW(14), HOLD_ROW(15)
+};
+
+// psg.c drops the write when the attenuation didn't change
+static void env_write(uint8_t ch, psgenv_state_t *e) {
+  psg_setEnvelope(ch, PSG_ENVELOPE_MIN - e->level / ENV_SCALE);
+}
+
+// one frame of the macros, then the pitch or noise mode if it changed
+static void env_macros(uint8_t ch, psgenv_state_t *e) {
+  int16_t note = e->note + macro_next(&e->arp);
+
+  e->bend += macro_next(&e->pitch);
+
+  if (ch == PSG_ENV_NOISE) {
+    uint8_t mode = e->noise.data ? (uint8_t)macro_next(&e->noise) & 7 : e->note & 7;
+    if (mode != e->mode) psg_setNoise(mode >> 2, mode & 3);
+    e->mode = mode;
+  } else {
+    if (note < 0) note = 0;
+    int16_t counter = psg_note_counter(note) - e->bend; // smaller counts are higher
+    if (counter < 1) counter = 1;
+    if (counter > 0x3FF) counter = 0x3FF;
+    psg_setTone(ch, counter);
+  }
+}
+
+static void env_advance(uint8_t ch) {
+  psgenv_state_t *e = &envs[ch];
+  const psgenv_shape_t *shape = &psgenv_shapes[ch];
+
+  switch (e->phase) {
+  case ENV_ATTACK:
+    if (e->peak - e->level > envStep[shape->attack]) {
+      e->level += envStep[shape->attack];
+      break;
+    }
+    e->level = e->peak;
+    e->phase = ENV_DECAY;
+    // fall through, a level already at the top starts decaying straight away
+  case ENV_DECAY:
+    if (e->level > e->hold + envStep[shape->decay]) {
+      e->level -= envStep[shape->decay];
+    } else {
+      e->level = e->hold;
+      e->phase = ENV_SUSTAIN;
+    }
+    break;
+  case ENV_RELEASE:
+    if (e->level > envStep[shape->release]) {
+      e->level -= envStep[shape->release];
+    } else {
+      e->level = 0;
+      e->phase = ENV_OFF;
+    }
+    break;
+  default:
+    break;
+  }
+  env_write(ch, e);
+}
+
+void psgenv_init() {
+  psg_reset(); // silent, and the psg shadows match the chip again
+  for (uint8_t ch = 0; ch < PSG_ENV_CHANNELS; ch++) {
+    envs[ch].phase = ENV_OFF;
+    envs[ch].level = 0;
+    envs[ch].mode = 0xFF;
+  }
+}
+
+// start the attack from wherever the level is now, so retriggers don't click.
+// the first step goes out straight away rather than on the next frame
+void psgenv_note_on(uint8_t ch, uint8_t note, uint8_t volume) {
+  psgenv_state_t *e = &envs[ch];
+  const psgenv_shape_t *shape = &psgenv_shapes[ch];
+
+  e->note = note;
+  e->bend = 0;
+  macro_start(&e->arp, MACRO_ARP, shape->arp);
+  macro_start(&e->pitch, MACRO_PITCH, shape->pitch);
+  macro_start(&e->noise, MACRO_NOISE, shape->noise);
+  if (ch == PSG_ENV_NOISE) e->mode = 0xFF; // a new noise note restarts the shift register
+  env_macros(ch, e);
+
+  if (volume > PSG_ENV_LEVEL_MAX) volume = PSG_ENV_LEVEL_MAX;
+  e->peak = volume * ENV_SCALE;
+  e->hold = envHold[volume][shape->sustain & PSG_ENV_LEVEL_MAX];
+  if (e->level > e->peak) e->level = e->peak;
+  e->phase = ENV_ATTACK;
+  env_advance(ch);
+}
+
+void psgenv_note_off(uint8_t ch) {
+  if (envs[ch].phase != ENV_OFF) {
+    envs[ch].phase = ENV_RELEASE;
+    env_advance(ch);
+  }
+}
+
+void psgenv_release_all() {
+  for (uint8_t ch = 0; ch < PSG_ENV_CHANNELS; ch++) {
+    psgenv_note_off(ch);
+  }
+}
+
+void psgenv_tick() {
+  for (uint8_t ch = 0; ch < PSG_ENV_CHANNELS; ch++) {
+    if (envs[ch].phase == ENV_OFF) continue;
+    env_macros(ch, &envs[ch]);
+    if (envs[ch].phase != ENV_SUSTAIN) {
+      env_advance(ch);
+    }
+  }
+}
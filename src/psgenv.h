@@ -0,0 +1,32 @@
+#ifndef H_PSGENV
+#define H_PSGENV
+
+#include <stdint.h>
+
+#define PSG_ENV_CHANNELS 4 // three tone channels and the noise channel
+#define PSG_ENV_NOISE 3
+#define PSG_ENV_RATE_MAX 15 // 0 is instant, 15 the slowest
+#define PSG_ENV_LEVEL_MAX 15
+
+typedef struct {
+  uint8_t attack;  // rate up to the note volume
+  uint8_t decay;   // rate down to the sustain level
+  uint8_t sustain; // 0-15, a fraction of the note volume held while the note is on
+  uint8_t release; // rate down to silence after the note ends
+  uint8_t arp;     // macro bank entries, 0 for none
+  uint8_t pitch;
+  uint8_t noise;
+} psgenv_shape_t;
+
+extern psgenv_shape_t psgenv_shapes[PSG_ENV_CHANNELS];
+
+void psgenv_init();
+// note is a psg note for the tone channels and a noise mode for the noise channel
+void psgenv_note_on(uint8_t ch, uint8_t note, uint8_t volume);
+void psgenv_note_off(uint8_t ch);
+void psgenv_release_all();
+// once per frame, steps the envelopes and macros and only writes a register
+// when its value changes
+void psgenv_tick();
+
+#endif
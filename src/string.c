@@ -305,3 +305,38 @@ uint16_t sprintf(char *buffer, const char *fmt, ...)
 
     return i;
 }
+
+// also what gcc calls for large struct copies, -nostdlib leaves it to us.
+// word moves when both sides are even, which structs always are on m68k
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+void *memcpy(void *dst, const void *src, size_t len)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    if (!(((uintptr_t)d | (uintptr_t)s) & 1)) {
+        uint16_t *dw = (uint16_t *)d;
+        const uint16_t *sw = (const uint16_t *)s;
+
+        for (; len >= 2; len -= 2)
+            *dw++ = *sw++;
+        d = (uint8_t *)dw;
+        s = (const uint8_t *)sw;
+    }
+    while (len--)
+        *d++ = *s++;
+
+    return dst;
+}
+
+int memcmp(const void *a, const void *b, size_t len)
+{
+    const uint8_t *x = a;
+    const uint8_t *y = b;
+
+    for (; len; len--, x++, y++)
+        if (*x != *y)
+            return *x - *y;
+
+    return 0;
+}
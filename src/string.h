@@ -20,3 +20,5 @@ typedef __gnuc_va_list va_list;
 uint32_t strlen(const char *str);
 uint16_t strnlen(const char *str, uint16_t maxlen);
 uint16_t sprintf(char *buffer,const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+void *memcpy(void *dst, const void *src, size_t len);
+int memcmp(const void *a, const void *b, size_t len);
@@ -0,0 +1,89 @@
+#include "trig.h"
+
+#define TRIG_ALWAYS 0
+#define TRIG_PROB 1     // a is the chance out of 256
+#define TRIG_LOOP 2     // a is the loop - 1, b the cycle length
+#define TRIG_FILL 3
+#define TRIG_NOT_FILL 4
+
+typedef struct {
+  uint8_t type;
+  uint8_t a;
+  uint8_t b;
+} trig_cond_t;
+
+#define PROB(p) {TRIG_PROB, (p) * 256 / 100, 0}
+#define LOOP(a, b) {TRIG_LOOP, (a) - 1, (b)}
+
+static const trig_cond_t conds[TRIG_COND_COUNT] = {
+  {TRIG_ALWAYS, 0, 0},
+  PROB(1), PROB(3), PROB(6), PROB(9), PROB(13), PROB(19), PROB(25),
+  PROB(33), PROB(41), PROB(50), PROB(59), PROB(67), PROB(75), PROB(81),
+  PROB(87), PROB(91), PROB(94), PROB(96), PROB(98), PROB(99),
+  LOOP(1, 2), LOOP(2, 2),
+  LOOP(1, 3), LOOP(2, 3), LOOP(3, 3),
+  LOOP(1, 4), LOOP(2, 4), LOOP(3, 4), LOOP(4, 4),
+  LOOP(1, 5), LOOP(2, 5), LOOP(3, 5), LOOP(4, 5), LOOP(5, 5),
+  LOOP(1, 6), LOOP(2, 6), LOOP(3, 6), LOOP(4, 6), LOOP(5, 6), LOOP(6, 6),
+  LOOP(1, 7), LOOP(2, 7), LOOP(3, 7), LOOP(4, 7), LOOP(5, 7), LOOP(6, 7), LOOP(7, 7),
+  LOOP(1, 8), LOOP(2, 8), LOOP(3, 8), LOOP(4, 8), LOOP(5, 8), LOOP(6, 8), LOOP(7, 8), LOOP(8, 8),
+  {TRIG_FILL, 0, 0}, {TRIG_NOT_FILL, 0, 0}
+};
+
+static const char *const condNames[TRIG_COND_COUNT] = {
+  "none ",
+  "1%   ", "3%   ", "6%   ", "9%   ", "13%  ", "19%  ", "25%  ",
+  "33%  ", "41%  ", "50%  ", "59%  ", "67%  ", "75%  ", "81%  ",
+  "87%  ", "91%  ", "94%  ", "96%  ", "98%  ", "99%  ",
+  "1:2  ", "2:2  ",
+  "1:3  ", "2:3  ", "3:3  ",
+  "1:4  ", "2:4  ", "3:4  ", "4:4  ",
+  "1:5  ", "2:5  ", "3:5  ", "4:5  ", "5:5  ",
+  "1:6  ", "2:6  ", "3:6  ", "4:6  ", "5:6  ", "6:6  ",
+  "1:7  ", "2:7  ", "3:7  ", "4:7  ", "5:7  ", "6:7  ", "7:7  ",
+  "1:8  ", "2:8  ", "3:8  ", "4:8  ", "5:8  ", "6:8  ", "7:8  ", "8:8  ",
+  "fill ", "!fill"
+};
+
+static uint16_t lfsr = 0xACE1; // never 0, or it stays 0
+
+// 16 bit galois lfsr, taps 16 14 13 11, a shift and an xor per number
+static uint16_t trig_random() {
+  lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+  return lfsr;
+}
+
+void trig_loops_reset(trig_loops_t *loops) {
+  for (uint8_t i = 0; i < TRIG_LOOP_MAX - 1; i++) {
+    loops->count[i] = 0;
+  }
+}
+
+void trig_loops_next(trig_loops_t *loops) {
+  for (uint8_t i = 0; i < TRIG_LOOP_MAX - 1; i++) {
+    if (++loops->count[i] >= i + 2) loops->count[i] = 0;
+  }
+}
+
+uint8_t trig_pass(uint8_t cond, const trig_loops_t *loops, uint8_t fill) {
+  const trig_cond_t *c;
+
+  if (cond >= TRIG_COND_COUNT) return 1;
+  c = &conds[cond];
+  switch (c->type) {
+  case TRIG_PROB:
+    return (trig_random() & 0xFF) < c->a;
+  case TRIG_LOOP:
+    return loops->count[c->b - 2] == c->a;
+  case TRIG_FILL:
+    return fill;
+  case TRIG_NOT_FILL:
+    return !fill;
+  default:
+    return 1;
+  }
+}
+
+const char *trig_name(uint8_t cond) {
+  return condNames[cond < TRIG_COND_COUNT ? cond : 0];
+}
@@ -0,0 +1,26 @@
+#ifndef H_TRIG
+#define H_TRIG
+
+#include <stdint.h>
+
+// trig conditions: whether a step plays this time round. a condition is an
+// index into a fixed table, 0 always plays, then the probabilities, the
+// a:b loop conditions (play on loop a of every b) and the fill conditions
+#define TRIG_NONE 0
+#define TRIG_COND_COUNT 58
+#define TRIG_LOOP_MAX 8 // longest a:b cycle
+
+// pattern loops so far, counted separately for every cycle length so the
+// test is a compare and never a divide
+typedef struct {
+  uint8_t count[TRIG_LOOP_MAX - 1]; // loops mod 2 to mod 8
+} trig_loops_t;
+
+void trig_loops_reset(trig_loops_t *loops);
+// at the end of every pass through the pattern
+void trig_loops_next(trig_loops_t *loops);
+// 1 when the step plays, rolls the random number for the probabilities
+uint8_t trig_pass(uint8_t cond, const trig_loops_t *loops, uint8_t fill);
+const char *trig_name(uint8_t cond);
+
+#endif
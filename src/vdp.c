@@ -26,6 +26,7 @@ extern const uint32_t FONT_TILES[];
 static volatile uint16_t* const vdp_data_port = (uint16_t*) 0xC00000;
 static volatile uint16_t* const vdp_ctrl_port = (uint16_t*) 0xC00004;
 static volatile uint32_t* const vdp_ctrl_wide = (uint32_t*) 0xC00004;
+static volatile uint16_t* const vdp_hv_port = (uint16_t*) 0xC00008;
 
 // Palette vars
 static uint16_t pal_current[64];
@@ -98,6 +99,21 @@ void vdp_vsync() {
   while(*vdp_ctrl_port & 8) {};
 }
 
+// Status
+
+uint16_t vdp_get_palmode() {
+  return *vdp_ctrl_port & 1;
+}
+
+uint16_t vdp_get_vblank() {
+  return *vdp_ctrl_port & 8;
+}
+
+// scanline counter from the hv counter port, it skips back during vblank
+uint8_t vdp_get_vcount() {
+  return *vdp_hv_port >> 8;
+}
+
 // Register stuff
 
 void vdp_set_display(uint8_t enabled) {
@@ -125,6 +141,12 @@ void vdp_set_window(uint8_t x, uint8_t y) {
   *vdp_ctrl_port = 0x9200 | y;
 }
 
+// horizontal interrupt every lines scanlines of the active display, 0 = off
+void vdp_set_hint(uint8_t lines) {
+  *vdp_ctrl_port = 0x8A00 | (lines ? lines - 1 : 0xFF);
+  *vdp_ctrl_port = 0x8004 | (lines ? 0x10 : 0);
+}
+
 // DMA stuff
 
 static void dma_do(uint32_t from, uint16_t len, uint32_t cmd) {
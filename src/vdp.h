@@ -91,10 +91,12 @@ void vdp_set_scrollmode(uint8_t hoz, uint8_t vert);
 void vdp_set_highlight(uint8_t enabled);
 void vdp_set_backcolor(uint8_t index);
 void vdp_set_window(uint8_t x, uint8_t y);
+void vdp_set_hint(uint8_t lines);
 
 // Status
 uint16_t vdp_get_palmode();
 uint16_t vdp_get_vblank();
+uint8_t vdp_get_vcount();
 
 // DMA stuff
 void vdp_dma_vram(uint32_t from, uint16_t to, uint16_t len);
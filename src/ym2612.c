@@ -1,6 +1,119 @@
+#include "md.h"
 #include "ym2612.h"
 #include "z80.h"
 
+// channel codes for the key on register 0x28, there is no code 3
+static const uint8_t ym_keyon_chan[YM_CHAN_COUNT] = {0, 1, 2, 4, 5, 6};
+
+// register offsets of operators 1-4, the chip orders them 1, 3, 2, 4
+static const uint8_t ym_op_offset[4] = {0x0, 0x8, 0x4, 0xC};
+
+// channel 3 special mode frequency registers of operators 1-4, op4 uses the
+// normal channel 3 pair
+static const uint8_t ym_ch3_fnum_lo[4] = {0xA9, 0xAA, 0xA8, 0xA2};
+static const uint8_t ym_ch3_fnum_hi[4] = {0xAD, 0xAE, 0xAC, 0xA6};
+
+// register 0x27 is shared by the channel 3 mode and the timers
+static uint8_t ym_reg27 = 0x00;
+
+// equal tempered, A4 = 440Hz on the ntsc fm clock:
+// fnum = 440 * 2^((i / 32 - 9) / 12) * 144 * 2^20 / (53693175 / 7) / 2^(4 - 1)
+const uint16_t ym_fine_fnum[12 * YM_PITCH_FINE] = {
+  // C
+  0x284, 0x285, 0x286, 0x287, 0x288, 0x28A, 0x28B, 0x28C,
+  0x28D, 0x28E, 0x28F, 0x291, 0x292, 0x293, 0x294, 0x295,
+  0x297, 0x298, 0x299, 0x29A, 0x29B, 0x29D, 0x29E, 0x29F,
+  0x2A0, 0x2A1, 0x2A3, 0x2A4, 0x2A5, 0x2A6, 0x2A8, 0x2A9,
+  // C#
+  0x2AA, 0x2AB, 0x2AD, 0x2AE, 0x2AF, 0x2B0, 0x2B1, 0x2B3,
+  0x2B4, 0x2B5, 0x2B6, 0x2B8, 0x2B9, 0x2BA, 0x2BC, 0x2BD,
+  0x2BE, 0x2BF, 0x2C1, 0x2C2, 0x2C3, 0x2C4, 0x2C6, 0x2C7,
+  0x2C8, 0x2CA, 0x2CB, 0x2CC, 0x2CD, 0x2CF, 0x2D0, 0x2D1,
+  // D
+  0x2D3, 0x2D4, 0x2D5, 0x2D7, 0x2D8, 0x2D9, 0x2DA, 0x2DC,
+  0x2DD, 0x2DE, 0x2E0, 0x2E1, 0x2E2, 0x2E4, 0x2E5, 0x2E6,
+  0x2E8, 0x2E9, 0x2EA, 0x2EC, 0x2ED, 0x2EF, 0x2F0, 0x2F1,
+  0x2F3, 0x2F4, 0x2F5, 0x2F7, 0x2F8, 0x2F9, 0x2FB, 0x2FC,
+  // D#
+  0x2FE, 0x2FF, 0x300, 0x302, 0x303, 0x305, 0x306, 0x307,
+  0x309, 0x30A, 0x30C, 0x30D, 0x30E, 0x310, 0x311, 0x313,
+  0x314, 0x315, 0x317, 0x318, 0x31A, 0x31B, 0x31D, 0x31E,
+  0x31F, 0x321, 0x322, 0x324, 0x325, 0x327, 0x328, 0x32A,
+  // E
+  0x32B, 0x32D, 0x32E, 0x330, 0x331, 0x332, 0x334, 0x335,
+  0x337, 0x338, 0x33A, 0x33B, 0x33D, 0x33E, 0x340, 0x341,
+  0x343, 0x344, 0x346, 0x347, 0x349, 0x34A, 0x34C, 0x34D,
+  0x34F, 0x351, 0x352, 0x354, 0x355, 0x357, 0x358, 0x35A,
+  // F
+  0x35B, 0x35D, 0x35E, 0x360, 0x362, 0x363, 0x365, 0x366,
+  0x368, 0x369, 0x36B, 0x36D, 0x36E, 0x370, 0x371, 0x373,
+  0x375, 0x376, 0x378, 0x379, 0x37B, 0x37D, 0x37E, 0x380,
+  0x381, 0x383, 0x385, 0x386, 0x388, 0x38A, 0x38B, 0x38D,
+  // F#
+  0x38E, 0x390, 0x392, 0x393, 0x395, 0x397, 0x398, 0x39A,
+  0x39C, 0x39D, 0x39F, 0x3A1, 0x3A2, 0x3A4, 0x3A6, 0x3A7,
+  0x3A9, 0x3AB, 0x3AC, 0x3AE, 0x3B0, 0x3B2, 0x3B3, 0x3B5,
+  0x3B7, 0x3B8, 0x3BA, 0x3BC, 0x3BE, 0x3BF, 0x3C1, 0x3C3,
+  // G
+  0x3C5, 0x3C6, 0x3C8, 0x3CA, 0x3CC, 0x3CD, 0x3CF, 0x3D1,
+  0x3D3, 0x3D4, 0x3D6, 0x3D8, 0x3DA, 0x3DB, 0x3DD, 0x3DF,
+  0x3E1, 0x3E3, 0x3E4, 0x3E6, 0x3E8, 0x3EA, 0x3EC, 0x3ED,
+  0x3EF, 0x3F1, 0x3F3, 0x3F5, 0x3F7, 0x3F8, 0x3FA, 0x3FC,
+  // G#
+  0x3FE, 0x400, 0x402, 0x403, 0x405, 0x407, 0x409, 0x40B,
+  0x40D, 0x40F, 0x411, 0x412, 0x414, 0x416, 0x418, 0x41A,
+  0x41C, 0x41E, 0x420, 0x422, 0x423, 0x425, 0x427, 0x429,
+  0x42B, 0x42D, 0x42F, 0x431, 0x433, 0x435, 0x437, 0x439,
+  // A
+  0x43B, 0x43D, 0x43F, 0x441, 0x443, 0x445, 0x446, 0x448,
+  0x44A, 0x44C, 0x44E, 0x450, 0x452, 0x454, 0x456, 0x458,
+  0x45A, 0x45C, 0x45E, 0x460, 0x462, 0x465, 0x467, 0x469,
+  0x46B, 0x46D, 0x46F, 0x471, 0x473, 0x475, 0x477, 0x479,
+  // A#
+  0x47B, 0x47D, 0x47F, 0x481, 0x483, 0x485, 0x488, 0x48A,
+  0x48C, 0x48E, 0x490, 0x492, 0x494, 0x496, 0x498, 0x49B,
+  0x49D, 0x49F, 0x4A1, 0x4A3, 0x4A5, 0x4A7, 0x4AA, 0x4AC,
+  0x4AE, 0x4B0, 0x4B2, 0x4B4, 0x4B7, 0x4B9, 0x4BB, 0x4BD,
+  // B
+  0x4BF, 0x4C1, 0x4C4, 0x4C6, 0x4C8, 0x4CA, 0x4CD, 0x4CF,
+  0x4D1, 0x4D3, 0x4D5, 0x4D8, 0x4DA, 0x4DC, 0x4DE, 0x4E1,
+  0x4E3, 0x4E5, 0x4E7, 0x4EA, 0x4EC, 0x4EE, 0x4F1, 0x4F3,
+  0x4F5, 0x4F7, 0x4FA, 0x4FC, 0x4FE, 0x501, 0x503, 0x505
+};
+
+// block << 4 | semitone for every midi note, clamped to the 12-107 range
+static const uint8_t ym_note_octave[128] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B,
+  0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B,
+  0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B,
+  0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B,
+  0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B,
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B,
+  0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B,
+  0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B
+};
+
+// last A4:A0 pair written to each channel, so unchanged pitches cost nothing
+static uint16_t ym_fnum_shadow[YM_CHAN_COUNT];
+// the chip has a single A4-A6 latch that is applied by the next A0-A2 write
+static uint8_t ym_fnum_latch;
+// total levels and feedback/algorithm, the registers parameter locks change
+// at a step. 0xFF is never a valid value, so it forces the next write
+static uint8_t ym_tl_shadow[YM_CHAN_COUNT][4];
+static uint8_t ym_fb_algo_shadow[YM_CHAN_COUNT];
+
+// operator key bits per channel (bit 0 = op1): what the chip has now, what
+// it should have after the next flush, and which operators restart on the way
+static uint8_t ym_key_now[YM_CHAN_COUNT];
+static uint8_t ym_key_next[YM_CHAN_COUNT];
+static uint8_t ym_key_retrig[YM_CHAN_COUNT];
+
+// operators that reach the output for each algorithm
+const uint8_t ym_carrier_mask[8] = {0x8, 0x8, 0x8, 0x8, 0xA, 0xE, 0xE, 0xF};
+
 // write a global register
 void YM2612_writeReg(const uint16_t part, const uint8_t reg, const uint8_t data)
 {
@@ -33,8 +146,7 @@ void YM2612_writeReg(const uint16_t part, const uint8_t reg, const uint8_t data)
 // write a register for a specific channel and operator (sl = operator number 0-3)
 static void writeSlotReg(uint16_t port, uint8_t ch, uint8_t sl,
 			 uint8_t reg, uint8_t value) {
-    YM2612_write((port * 2) + 0, reg | (sl * 4) | ch);
-    YM2612_write((port * 2) + 1, value);
+    ym_write(port * 2, reg | (sl * 4) | ch, value);
 }
 
 void YM2612_writeSlotReg(uint16_t port, uint8_t ch, uint8_t sl,
@@ -43,100 +155,92 @@ void YM2612_writeSlotReg(uint16_t port, uint8_t ch, uint8_t sl,
 }
 
 
-// write a specific channel register
-static void writeChannelReg(uint16_t port, uint8_t ch, uint8_t reg,
-			    uint8_t value)
-{
-    YM2612_write((port * 2) + 0, reg | ch);
-    YM2612_write((port * 2) + 1, value);
+// reset values for one operator as (register, value) pairs. everything is
+// silent and released except what the starting patch below changes
+#define YM_INIT_OP(c, o, dtmul, tl, ar)				\
+  0x30 | (o) | (c), (dtmul), 0x40 | (o) | (c), (tl),		\
+  0x50 | (o) | (c), (ar), 0x60 | (o) | (c), 0x00,		\
+  0x70 | (o) | (c), 0x00, 0x80 | (o) | (c), 0xFF,		\
+  0x90 | (o) | (c), 0x00
+
+// every voice gets the same starting patch so the allocator can use any of
+// them: algorithm 0, feedback 6, a sine on op4 modulated by op2
+#define YM_INIT_CHAN(c)						\
+  YM_INIT_OP(c, 0x0, 0x00, 0x7F, 0x00), /* op1 muted */		\
+  YM_INIT_OP(c, 0x4, 0x00, 0x7F, 0x00), /* op3 muted */		\
+  YM_INIT_OP(c, 0x8, 0x52, 0x0A, 0x00), /* op2 detune 5, mult 2 */	\
+  YM_INIT_OP(c, 0xC, 0x01, 0x00, 0x1F), /* op4 mult 1, instant attack */ \
+  0xA4 | (c), 0x00, 0xA0 | (c), 0x00,				\
+  0xB0 | (c), 0x06,						\
+  0xB4 | (c), 0xFD /* left + right, ams 3, fms 5 */
+
+// the whole reset as one stream per port, built by the compiler. port 1
+// stops at channel 5, channel 6 belongs to the dac
+static const uint8_t ym_init_port0[] = {
+  0x22, 0x00, // lfo off
+  0x27, 0x00, // normal channel 3, timers off
+  YM_INIT_CHAN(0), YM_INIT_CHAN(1), YM_INIT_CHAN(2),
+  // channel 3 special mode frequencies
+  0xAC, 0x00, 0xA8, 0x00, 0xAD, 0x00, 0xA9, 0x00, 0xAE, 0x00, 0xAA, 0x00
+};
+
+static const uint8_t ym_init_port1[] = {
+  YM_INIT_CHAN(0), YM_INIT_CHAN(1)
+};
+
+#ifndef YM_HOST_CHECK
+// write (register, value) pairs to one port with the ym_write handshake,
+// without a call per register
+static void ym_write_pairs(int which, const uint8_t *pairs, uint16_t count) {
+  volatile int8_t *pb = (volatile int8_t*) YM2612_BASEPORT;
+  uint16_t port = which & 2;
+
+  while (count--) {
+    while (*pb < 0);
+    pb[port] = *pairs++;
+    __asm__ __volatile__("nop");
+    pb[port + 1] = *pairs++;
+    __asm__ __volatile__("nop"); // busy flag lags the data write
+  }
+}
+#else
+// tools/fnumcheck.c builds this file for the host with its own ym_write,
+// which stands in for the chip. everything that writes goes through it
+static void ym_write_pairs(int which, const uint8_t *pairs, uint16_t count) {
+  for (; count--; pairs += 2) ym_write(which, pairs[0], pairs[1]);
 }
 
+void ym_write_repeat(int which, uint8_t addr, const uint8_t *values, uint8_t count) {
+  while (count--) ym_write(which, addr, *values++);
+}
+#endif
+
 void __attribute__ ((noinline)) YM2612_reset(int takez80bus)
 {
-    uint16_t p, ch, sl;
     uint16_t busTaken = 0;
+    // ALL KEY OFF, the dac channel has no key to release
+    static const uint8_t allKeysOff[YM_VOICE_COUNT] = {0x00, 0x01, 0x02, 0x04, 0x05};
 
     if (takez80bus) {
       busTaken = Z80_getAndRequestBus(1);
     }
 
-    // disable LFO
-    YM2612_write(0, 0x22);
-    YM2612_write(1, 0x00);
-
-    for(p = 0; p < 2; p++) // port - 0 or 1 to control channels 0-3 or 4-6
-    {
-      for(ch = 0; ch < 3; ch++) // channel on current port - 0-2
-        {
-	  for(sl = 0; sl < 4; sl++) // 'slot' - operator on current channel and port
-            {
-
-	      if (p == 1 && ch == 2) continue; // don't mess with our dac channel
-		
-                // DT1 - MUL
-                writeSlotReg(p, ch, sl, 0x30, 0x00);
-		
-                // TL set to max (silent)
-                writeSlotReg(p, ch, sl, 0x40, 0x7F);
-		
-                // RS - AR
-                writeSlotReg(p, ch, sl, 0x50, 0x00);
-		
-                // AM - D1R
-                writeSlotReg(p, ch, sl, 0x60, 0x00);
-		
-                // D2R
-                writeSlotReg(p, ch, sl, 0x70, 0x00);
-                // D1L - RR set to max
-                writeSlotReg(p, ch, sl, 0x80, 0xFF);
-                // SSG-EG
-                writeSlotReg(p, ch, sl, 0x90, 0x00);
-            }
-        }
+    for (uint8_t ch = 0; ch < YM_CHAN_COUNT; ch++) {
+      ym_fnum_shadow[ch] = 0x0000; // the streams leave every frequency at 0
+      ym_key_now[ch] = 0;
+      ym_key_next[ch] = 0;
+      ym_key_retrig[ch] = 0;
+      ym_fb_algo_shadow[ch] = 0xFF;
+      for (uint8_t op = 0; op < 4; op++) {
+        ym_tl_shadow[ch][op] = 0xFF;
+      }
     }
+    ym_fnum_latch = 0x00;
+    ym_reg27 = 0x00;
 
-    for(p = 0; p < 2; p++)
-    {
-        for(ch = 0; ch < 3; ch++)
-        {
-
-	  if (p == 1 && ch == 2) continue; // don't mess with our dac channel
-	  
-            // Freq LSB
-            writeChannelReg(p, ch, 0xA0, 0x00);
-            // Block - Freq MSB
-            writeChannelReg(p, ch, 0xA4, 0x00);
-            // Freq LSB - CH3 spe
-            writeChannelReg(p, ch, 0xA8, 0x00);
-            // Block - Freq MSB - CH3 spe
-            writeChannelReg(p, ch, 0xAC, 0x00);
-            // Feedback - Algo
-            writeChannelReg(p, ch, 0xB0, 0x00);
-            // enable LR output
-            writeChannelReg(p, ch, 0xB4, 0xC0);
-        }
-    }
-
-    // extra stuff from play_sinewave needed to make it play - not sure why yet
-    ym_write(0, 0x22, 8 & 1); // Enable LFO
-    ym_write(0, 0x27, 0x00); // Normal mode (Timer/Ch3)
-    ym_write(0, 0xB0, 0x06); // Algorithm 0 , Feedback 6
-    ym_write(0, 0xB4, 0xFD); // Panning: Left + Right enable (bit 8 and 7), amplitude mod sensitivity (bit 6 and 5),
-                             // frequency mod sensitivity (bit 3,2,1)
-    ym_write(0, 0x3C, 0x01); // DT1/Multi: Multiplier 1 ch0 op4
-    ym_write(0, 0x38, 0x52); // DT1/Multi: (bits 7-5 detune) (bits 4-1 multiplier) ch0 op3
-    ym_write(0, 0x44, 0x7F); // Op 2 TL: 127 (Mute)
-    ym_write(0, 0x48, 0x0a); // Op 3 TL: 127 (Mute)
-    ym_write(0, 0x4C, 0x00); // Op 4 TL
-    ym_write(0, 0x5C, 0x1F); // Attack Rate: 31 (Instant) ch 0 operator 4    
-
-    // ALL KEY OFF
-    //    YM2612_write(0, 0x28);
-    //    for (ch = 0; ch < 3; ch++)
-    //    {
-    //        YM2612_write(1, 0x00 | ch);
-    //        YM2612_write(1, 0x04 | ch);
-    //    }
+    ym_write_repeat(0, 0x28, allKeysOff, YM_VOICE_COUNT);
+    ym_write_pairs(0, ym_init_port0, sizeof(ym_init_port0) / 2);
+    ym_write_pairs(2, ym_init_port1, sizeof(ym_init_port1) / 2);
 
     if (!busTaken)
         Z80_releaseBus();
@@ -194,9 +298,73 @@ void YM2612_disableDAC()
     YM2612_writeReg(0, 0x2B, 0x00);
 }
 
-void ym_write(int which, uint8_t addr, uint8_t value) {
-  YM2612_write(which, addr);
-  YM2612_write(which+1, value);
+#ifndef YM_HOST_CHECK
+// only the data write makes the chip busy, so the pair needs a single poll up
+// front. no trailing nops: the busy flag comes up within the one nop (4
+// cycles) that YM2612_write and ym_write_pairs wait after a data write, and
+// leaving this function and calling it again takes at least an rts and a
+// bsr, 16 + 18 cycles, before the next poll. that only holds if every write
+// goes through a real call, hence noinline
+void __attribute__ ((noinline)) ym_write(int which, uint8_t addr, uint8_t value) {
+  volatile int8_t *pb = (volatile int8_t*) YM2612_BASEPORT;
+  uint16_t port = which & 2;
+
+  while (*pb < 0);
+  pb[port] = addr;
+  __asm__ __volatile__("nop"); // address to data setup time
+  pb[port + 1] = value;
+}
+
+// one address write followed by back to back data writes to that register,
+// for registers that take a stream of values like key on 0x28 or the dac.
+// the chip has no address auto increment so consecutive registers still need
+// an address write each, use ym_write for those
+void ym_write_repeat(int which, uint8_t addr, const uint8_t *values, uint8_t count) {
+  volatile int8_t *pb = (volatile int8_t*) YM2612_BASEPORT;
+  uint16_t port = which & 2;
+
+  while (*pb < 0);
+  pb[port] = addr;
+  while (count--) {
+    __asm__ __volatile__("nop"); // busy flag lags the previous data write
+    while (*pb < 0);
+    pb[port + 1] = *values++;
+  }
+}
+#endif
+
+// a scanline is 3420 master clocks and the 68k runs on the master clock / 7
+#define YM_FRAME_CYCLES(lines) ((uint32_t)(lines) * 3420 / 7)
+#define YM_BENCH_BATCH 8 // writes between vblank checks, so the loop adds little
+
+static void ym_bench_batch(int tuned) {
+  for (uint8_t i = 0; i < YM_BENCH_BATCH; i++) {
+    if (tuned) {
+      ym_write(0, 0x32, 0x00);
+    } else {
+      YM2612_write(0, 0x32);
+      YM2612_write(1, 0x00);
+    }
+  }
+}
+
+// 68k cycles one register write takes through the old two call path or
+// through ym_write, from how many fit in one frame. the z80 bus must be held
+// and the target register (ch3 op1 DT/MUL) must not matter, so only call
+// this right after a reset
+uint16_t YM2612_benchmarkWrites(int tuned) {
+  uint16_t count = 0;
+
+  vdp_vsync(); // start at the top of the display
+  while (!vdp_get_vblank()) {
+    ym_bench_batch(tuned);
+    count += YM_BENCH_BATCH;
+  }
+  while (vdp_get_vblank()) {
+    ym_bench_batch(tuned);
+    count += YM_BENCH_BATCH;
+  }
+  return YM_FRAME_CYCLES(pal_mode ? 313 : 262) / count;
 }
 
 void play_sine_wave() {
@@ -255,54 +423,229 @@ void play_sine_wave() {
     // ym_write(0, 0x28, 0xF0);
 }
 
-ym_pitch_t midi_to_ym2612(unsigned char midi_note)
+// fine pitch to the A4:A0 register pair, block in bits 13-11, fnum in 10-0.
+// table lookups only, no divide
+uint16_t ym_pitch_regs(int16_t pitch)
 {
-    ym_pitch_t p;
+    if (pitch < YM_PITCH_MIN) pitch = YM_PITCH_MIN;
+    if (pitch > YM_PITCH_MAX) pitch = YM_PITCH_MAX;
 
-    // Clamp MIDI range if needed
-    if (midi_note < 12)
-        midi_note = 12;
-    if (midi_note > 107)
-        midi_note = 107;
+    uint8_t octave = ym_note_octave[pitch >> 5];
+    uint16_t fnum = ym_fine_fnum[((octave & 0x0F) << 5) | (pitch & 0x1F)];
 
-    // Note within octave (0–11)
-    unsigned char note = midi_note % 12;
+    return ((uint16_t)(octave >> 4) << 11) | fnum;
+}
 
-    // MIDI octave number
-    int octave = (midi_note / 12) - 1;
+// set a channel frequency, skipping the write if it did not change and the
+// A4 write if the latch already holds the right value
+void ym_set_fnum(uint8_t ch, uint16_t regs)
+{
+    uint8_t hi = regs >> 8;
 
-    // Block mapping:
-    // C4 (octave 4) -> Block 4
-    int block = octave;
+    if (ym_fnum_shadow[ch] == regs) return;
 
-    if (block < 0) block = 0;
-    if (block > 7) block = 7;
+    if (ym_fnum_latch != hi) {
+      ym_write_chan(ch, 0xA4, hi);
+      ym_fnum_latch = hi;
+    }
+    ym_write_chan(ch, 0xA0, regs & 0xFF);
+    ym_fnum_shadow[ch] = regs;
+}
 
-    p.block = (unsigned char)block;
-    p.fnum  = ym_fnum_table[note];
+uint16_t ym_get_fnum(uint8_t ch)
+{
+    return ym_fnum_shadow[ch];
+}
 
-    return p;
+// write a channel register, channels 0-2 are on port 0 and 3-5 on port 1
+void ym_write_chan(uint8_t ch, uint8_t reg, uint8_t value) {
+  if (ch < 3) {
+    ym_write(0, reg | ch, value);
+  } else {
+    ym_write(2, reg | (ch - 3), value);
+  }
 }
 
-void ym_set_pitch_ch0(unsigned char midi_note)
+// write an operator register, op is 0-3 for operators 1-4
+void ym_write_op(uint8_t ch, uint8_t op, uint8_t reg, uint8_t value) {
+  ym_write_chan(ch, reg | ym_op_offset[op & 3], value);
+}
+
+// everything but 0xB4, pan stays with the channel
+void ym_write_patch(uint8_t ch, const ym_patch_t *patch) {
+  ym_set_fb_algo(ch, patch->fbAlgo);
+  for (uint8_t op = 0; op < 4; op++) {
+    for (uint8_t r = 0; r < 7; r++) {
+      if (r == 1) {
+        ym_set_tl(ch, op, patch->op[op][r]); // 0x40
+      } else {
+        ym_write_op(ch, op, 0x30 + (r << 4), patch->op[op][r]);
+      }
+    }
+  }
+}
+
+// total level of an operator, skipped when the chip already has it
+void ym_set_tl(uint8_t ch, uint8_t op, uint8_t tl) {
+  op &= 3;
+  tl &= 0x7F;
+  if (ym_tl_shadow[ch][op] == tl) return;
+  ym_write_op(ch, op, 0x40, tl);
+  ym_tl_shadow[ch][op] = tl;
+}
+
+// 0xB0, feedback in bits 5-3 and the algorithm in bits 2-0
+void ym_set_fb_algo(uint8_t ch, uint8_t fbAlgo) {
+  fbAlgo &= 0x3F;
+  if (ym_fb_algo_shadow[ch] == fbAlgo) return;
+  ym_write_chan(ch, 0xB0, fbAlgo);
+  ym_fb_algo_shadow[ch] = fbAlgo;
+}
+
+void ym_set_pitch(uint8_t ch, unsigned char midi_note)
 {
-    ym_pitch_t p = midi_to_ym2612(midi_note);
+    ym_set_fnum(ch, ym_pitch_regs(midi_note * YM_PITCH_FINE));
+}
 
-    // Block + FNUM high - write first
-    ym_write(0, 0xA4, (p.block << 3) | (p.fnum >> 8));
+void ym_noteon(uint8_t ch) {
+  ym_key_ops(ch, 0xF); // all four operators on
+}
 
-    // FNUM low
-    ym_write(0, 0xA0, p.fnum & 0xFF);
-    
+void ym_noteoff(uint8_t ch) {
+  ym_key_ops(ch, 0x0); // all four operators off
+}
+
+// key on the operators set in opMask (bit 0 = op1) and key off the rest, now
+void ym_key_ops(uint8_t ch, uint8_t opMask) {
+  opMask &= 0xF;
+  ym_write(0, 0x28, (opMask << 4) | ym_keyon_chan[ch]);
+  ym_key_now[ch] = opMask;
+  ym_key_next[ch] = opMask;
+  ym_key_retrig[ch] &= ~opMask;
+}
+
+// ask for opMask to be keyed on at the next flush, the operators in retrigMask
+// go through a key off first even if they are already on. a later call in
+// the same tick replaces opMask and adds to retrigMask
+void ym_key_queue(uint8_t ch, uint8_t opMask, uint8_t retrigMask) {
+  ym_key_next[ch] = opMask & 0xF;
+  ym_key_retrig[ch] |= retrigMask & 0xF;
+}
+
+// operators keyed on at the chip, queued changes not included
+uint8_t ym_key_state(uint8_t ch) {
+  return ym_key_now[ch];
+}
+
+// the envelope only sees a key off if it lasts past a sample boundary. a
+// sample is 144 fm clocks, and the fm chip and the 68k both run on the
+// master clock / 7, so it is 144 68k cycles on ntsc and pal alike. dbra
+// takes 10 cycles a turn and 14 to fall through: 15 turns are 164 cycles
+#define YM_SAMPLE_CYCLES 144
+static void ym_wait_sample() {
+#ifndef YM_HOST_CHECK
+  uint16_t turns = YM_SAMPLE_CYCLES / 10 + 1;
+
+  __asm__ __volatile__("1: dbra %0,1b" : "+d" (turns));
+#endif
+}
+
+// send every queued key change as two 0x28 streams: all the key offs, then
+// all the key ons. the chip only samples the key bits once per output sample
+// (fm clock / 144), so a retrigger waits that long between the two
+void ym_key_flush() {
+  uint8_t offs[YM_CHAN_COUNT];
+  uint8_t ons[YM_CHAN_COUNT];
+  uint8_t offCount = 0;
+  uint8_t onCount = 0;
+  uint8_t retrig = 0;
+
+  for (uint8_t ch = 0; ch < YM_CHAN_COUNT; ch++) {
+    uint8_t off = ym_key_now[ch] & (~ym_key_next[ch] | ym_key_retrig[ch]);
+
+    if (off) {
+      ym_key_now[ch] &= ~off;
+      offs[offCount++] = (ym_key_now[ch] << 4) | ym_keyon_chan[ch];
+      retrig |= ym_key_retrig[ch] & off;
+    }
+    if (ym_key_now[ch] != ym_key_next[ch]) {
+      ym_key_now[ch] = ym_key_next[ch];
+      ons[onCount++] = (ym_key_now[ch] << 4) | ym_keyon_chan[ch];
+    }
+    ym_key_retrig[ch] = 0;
+  }
+
+  if (offCount) ym_write_repeat(0, 0x28, offs, offCount);
+  if (retrig && onCount) ym_wait_sample();
+  if (onCount) ym_write_repeat(0, 0x28, ons, onCount);
+}
+
+// in special mode each operator of channel 3 takes its own frequency
+void ym_set_ch3_special(uint8_t enable) {
+  if (enable) {
+    ym_reg27 |= 0x40;
+  } else {
+    ym_reg27 &= ~0xC0;
+  }
+  ym_write(0, 0x27, ym_reg27);
+}
+
+// regs as from ym_pitch_regs, the high byte is block and fnum bits 10-8.
+// op4 goes through A6:A2, so the latch and the channel 3 shadow now hold its
+// value. the others use AC-AE, which some cores latch together with A4-A6,
+// so the next ym_set_fnum has to write its high byte again
+void ym_set_op_fnum(uint8_t op, uint16_t regs)
+{
+    op &= 3;
+    ym_write(0, ym_ch3_fnum_hi[op], regs >> 8);
+    ym_write(0, ym_ch3_fnum_lo[op], regs & 0xFF);
+    if (op == 3) {
+      ym_fnum_latch = regs >> 8;
+      ym_fnum_shadow[2] = regs;
+    } else {
+      ym_fnum_latch = 0xFF; // never a block/fnum high byte
+    }
+}
+
+// timer A counts at the chip sample rate (fm clock / 144, 18.77us on ntsc) and
+// overflows every 1024 - value counts, whatever the video refresh rate is
+void ym_timer_a_start(uint16_t value) {
+  ym_write(0, 0x24, (value >> 2) & 0xFF); // 8 msb
+  ym_write(0, 0x25, value & 0x03); // 2 lsb
+  ym_reg27 |= 0x05; // load the counter and raise the overflow flag
+  ym_write(0, 0x27, ym_reg27 | 0x10); // clear any old overflow
 }
 
+// a new period for the running timer, the counter picks it up when it next
+// overflows, so the tick it is counting now keeps its old length
+void ym_timer_a_period(uint16_t value) {
+  ym_write(0, 0x24, (value >> 2) & 0xFF);
+  ym_write(0, 0x25, value & 0x03);
+}
+
+void ym_timer_a_stop() {
+  ym_reg27 &= ~0x05;
+  ym_write(0, 0x27, ym_reg27 | 0x10);
+}
+
+// returns 1 once per overflow, the timer keeps reloading by itself
+uint8_t ym_timer_a_poll() {
+  if (!(YM2612_readStatus() & 0x01)) return 0;
+  ym_write(0, 0x27, ym_reg27 | 0x10); // acknowledge
+  return 1;
+}
+
+void ym_set_pitch_ch0(unsigned char midi_note)
+{
+    ym_set_pitch(0, midi_note);
+}
 
 void noteon_chan0() {
-  ym_write(0, 0x28, 0xF0); // key on
+  ym_noteon(0);
 }
 
 void noteoff_chan0() {
-  ym_write(0, 0x28, 0x00); // key off
+  ym_noteoff(0);
 }
 
 void YM2612_latchDacDataReg() {
@@ -5,27 +5,26 @@
 
 #define YM2612_BASEPORT     0xA04000
 
-// YM2612 F-Numbers for one octave at Block = 4
-// Notes: C  C#  D   D#  E   F   F#  G   G#  A   A#  B
-static const unsigned short ym_fnum_table[12] = {
-    0x22B, // C
-    0x250, // C#
-    0x279, // D
-    0x2A4, // D#
-    0x2D3, // E
-    0x305, // F
-    0x33B, // F#
-    0x374, // G
-    0x3B2, // G#
-    0x3F4, // A
-    0x43B, // A#
-    0x487  // B
-};
+#define YM_CHAN_COUNT 6
+#define YM_VOICE_COUNT 5 // channel 6 is used by the dac
 
+// pitches are in 1/32 semitone steps: midi note * 32 + fine
+#define YM_PITCH_FINE 32
+#define YM_PITCH_MIN (12 * YM_PITCH_FINE)
+#define YM_PITCH_MAX (107 * YM_PITCH_FINE + YM_PITCH_FINE - 1)
+
+// F-Numbers for one octave at Block = 4, YM_PITCH_FINE steps per semitone
+extern const uint16_t ym_fine_fnum[12 * YM_PITCH_FINE];
+
+// a whole fm voice as register bytes, see tools/fmimport and src/ympatches.h
 typedef struct {
-    unsigned char block;
-    unsigned short fnum;
-} ym_pitch_t;
+  const char *name;
+  uint8_t fbAlgo; // 0xB0
+  uint8_t amsFms; // 0xB4 without the pan bits
+  uint8_t op[4][7]; // 0x30-0x90 for op1-op4
+} ym_patch_t;
+
+extern const uint8_t ym_carrier_mask[8];
 
 void __attribute__ ((noinline)) YM2612_reset(int takez80bus);
 uint8_t YM2612_read(const uint16_t port);
@@ -35,12 +34,37 @@ void YM2612_writeReg(const uint16_t part, const uint8_t reg, const uint8_t data)
 void YM2612_enableDAC();
 void YM2612_disableDAC();
 void YM2612_latchDacDataReg();
-void ym_write(int which, uint8_t addr, uint8_t value);
+void __attribute__ ((noinline)) ym_write(int which, uint8_t addr, uint8_t value);
+void ym_write_repeat(int which, uint8_t addr, const uint8_t *values, uint8_t count);
+uint16_t YM2612_benchmarkWrites(int tuned);
 void play_sine_wave();
-ym_pitch_t midi_to_ym2612(unsigned char midi_note);
+uint16_t ym_pitch_regs(int16_t pitch);
+void ym_set_fnum(uint8_t ch, uint16_t regs);
+uint16_t ym_get_fnum(uint8_t ch);
+void ym_write_patch(uint8_t ch, const ym_patch_t *patch);
+void ym_set_tl(uint8_t ch, uint8_t op, uint8_t tl);
+void ym_set_fb_algo(uint8_t ch, uint8_t fbAlgo);
 void ym_set_pitch_ch0(unsigned char midi_note);
 void noteon_chan0();
 void noteoff_chan0();
+void ym_write_chan(uint8_t ch, uint8_t reg, uint8_t value);
+void ym_write_op(uint8_t ch, uint8_t op, uint8_t reg, uint8_t value);
+void ym_set_pitch(uint8_t ch, unsigned char midi_note);
+void ym_noteon(uint8_t ch);
+void ym_noteoff(uint8_t ch);
+void ym_key_ops(uint8_t ch, uint8_t opMask);
+void ym_key_queue(uint8_t ch, uint8_t opMask, uint8_t retrigMask);
+uint8_t ym_key_state(uint8_t ch);
+void ym_key_flush();
+void ym_set_ch3_special(uint8_t enable);
+void ym_set_op_fnum(uint8_t op, uint16_t regs);
+// timer A counts per second, fm clock / 144
+#define YM_TIMER_A_RATE_NTSC 53267
+#define YM_TIMER_A_RATE_PAL 52781
+void ym_timer_a_start(uint16_t value);
+void ym_timer_a_period(uint16_t value);
+void ym_timer_a_stop();
+uint8_t ym_timer_a_poll();
 void YM2612_writeSlotReg(uint16_t port, uint8_t ch, uint8_t sl,
 			 uint8_t reg, uint8_t value);
 
@@ -0,0 +1,44 @@
+// generated by tools/fmimport, do not edit
+#ifndef H_YMPATCHES
+#define H_YMPATCHES
+
+#include "ym2612.h"
+
+// name, fb/algo (0xB0), ams/fms (0xB4), then per operator
+// 0x30 0x40 0x50 0x60 0x70 0x80 0x90
+#define YM_PATCH_COUNT 5
+
+static const ym_patch_t ym_patches[YM_PATCH_COUNT] = {
+  { "bass", 0x30, 0x00, {
+    {0x01, 0x1E, 0x1F, 0x0A, 0x00, 0x36, 0x00}, // op1
+    {0x01, 0x18, 0x1F, 0x09, 0x00, 0x26, 0x00}, // op2
+    {0x00, 0x28, 0x1F, 0x0C, 0x00, 0x46, 0x00}, // op3
+    {0x01, 0x00, 0x5F, 0x08, 0x02, 0x58, 0x00}  // op4
+  } },
+  { "bell", 0x3D, 0x00, {
+    {0x07, 0x16, 0x1F, 0x0C, 0x04, 0x84, 0x00}, // op1
+    {0x23, 0x04, 0x1F, 0x08, 0x02, 0x65, 0x00}, // op2
+    {0x02, 0x02, 0x1F, 0x07, 0x02, 0x65, 0x00}, // op3
+    {0x64, 0x03, 0x1F, 0x06, 0x02, 0x65, 0x00}  // op4
+  } },
+  { "brass", 0x2A, 0x00, {
+    {0x01, 0x1C, 0x12, 0x06, 0x00, 0x26, 0x00}, // op1
+    {0x52, 0x1E, 0x10, 0x04, 0x00, 0x26, 0x00}, // op2
+    {0x11, 0x22, 0x14, 0x06, 0x00, 0x26, 0x00}, // op3
+    {0x01, 0x02, 0x13, 0x05, 0x01, 0x17, 0x00}  // op4
+  } },
+  { "epiano", 0x1C, 0x00, {
+    {0x0E, 0x30, 0x9F, 0x0E, 0x00, 0x65, 0x00}, // op1
+    {0x01, 0x00, 0x1F, 0x06, 0x03, 0x66, 0x00}, // op2
+    {0x11, 0x26, 0x5F, 0x0C, 0x00, 0x55, 0x00}, // op3
+    {0x51, 0x04, 0x1F, 0x05, 0x03, 0x66, 0x00}  // op4
+  } },
+  { "organ", 0x06, 0x02, {
+    {0x01, 0x1E, 0x1F, 0x00, 0x00, 0x06, 0x00}, // op1
+    {0x14, 0x24, 0x1F, 0x00, 0x00, 0x06, 0x00}, // op2
+    {0x02, 0x00, 0x1F, 0x00, 0x00, 0x06, 0x00}, // op3
+    {0x01, 0x00, 0x1F, 0x00, 0x00, 0x06, 0x00}  // op4
+  } },
+};
+
+#endif
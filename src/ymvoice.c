@@ -0,0 +1,193 @@
+#include "ymvoice.h"
+#include "ym2612.h"
+#include "z80.h"
+
+ym_voice_t ym_voices[YM_VOICE_COUNT];
+
+static uint8_t voiceMask = YM_VOICES_ALL; // channels the allocator may use
+static uint16_t voiceClock = 0; // bumped on every key event, gives the note order
+
+static int16_t laneLast[YM_CHORD_MAX]; // where the next note on each chord lane glides from
+static uint8_t laneVoice[YM_CHORD_MAX]; // channel of the last note on each lane
+static uint8_t legatoOps = 0; // operators a legato note restarts, 0 when legato is off
+static uint8_t glideRate = 0; // fine steps per frame / 4, 0 jumps straight to the note
+static uint8_t vibRate = 0;
+static uint8_t vibDepth = 0;
+static int8_t pitchBend = 0;
+static uint8_t arpMacro = 0;
+static uint8_t pitchMacro = 0;
+
+// one vibrato cycle
+static const int8_t vibSine[32] = {
+  0, 25, 49, 71, 90, 106, 117, 125, 127, 125, 117, 106, 90, 71, 49, 25,
+  0, -25, -49, -71, -90, -106, -117, -125, -127, -125, -117, -106, -90, -71, -49, -25
+};
+
+void ymvoice_init(uint8_t chanMask) {
+  voiceMask = chanMask & YM_VOICES_ALL;
+  voiceClock = 0;
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    ym_voices[ch].note = 0;
+    ym_voices[ch].held = 0;
+    ym_voices[ch].age = 0;
+    ym_voices[ch].pitch = 0;
+    ym_voices[ch].target = 0;
+    ym_voices[ch].vibPos = 0;
+    ym_voices[ch].lane = 0xFF;
+    ym_voices[ch].macroBend = 0;
+    ym_voices[ch].arpOffset = 0;
+    macro_start(&ym_voices[ch].arp, MACRO_ARP, 0);
+    macro_start(&ym_voices[ch].pitchMacro, MACRO_PITCH, 0);
+  }
+  for (uint8_t lane = 0; lane < YM_CHORD_MAX; lane++) {
+    laneLast[lane] = 0;
+    laneVoice[lane] = 0xFF;
+  }
+}
+
+uint8_t ymvoice_uses(uint8_t ch) {
+  return (voiceMask >> ch) & 1;
+}
+
+// key off everything still held, release tails keep ringing
+void ymvoice_release_all() {
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (ym_voices[ch].held) {
+      ym_key_queue(ch, 0x0, 0x0);
+      ym_voices[ch].held = 0;
+      ym_voices[ch].age = ++voiceClock;
+    }
+  }
+}
+
+// pick a channel for a new note: the free channel released longest ago so its
+// tail has had the most time to fade, otherwise steal the oldest held note
+static uint8_t pick_voice() {
+  uint8_t best = 0xFF;
+  uint16_t bestAge = 0;
+
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    // age is compared as a distance from now so the stamp can wrap
+    uint16_t age = voiceClock - ym_voices[ch].age;
+    if (!ym_voices[ch].held && (best == 0xFF || age > bestAge)) {
+      best = ch;
+      bestAge = age;
+    }
+  }
+  if (best != 0xFF) return best;
+
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    if (!ymvoice_uses(ch)) continue;
+    uint16_t age = voiceClock - ym_voices[ch].age;
+    if (best == 0xFF || age > bestAge) {
+      best = ch;
+      bestAge = age;
+    }
+  }
+  return best;
+}
+
+// pitch actually sent to the chip: glide position plus bend, macros and vibrato
+static uint16_t voice_regs(ym_voice_t *v) {
+  int16_t pitch = v->pitch + pitchBend + v->arpOffset * YM_PITCH_FINE + v->macroBend;
+
+  if (vibDepth) {
+    pitch += (vibSine[v->vibPos >> 3] * vibDepth) >> 5;
+  }
+  return ym_pitch_regs(pitch);
+}
+
+// start a note on the next channel and return the channel used. with glide
+// on, the note slides in from the last note played on the same chord lane.
+// with legato on, a lane whose last note is still sounding keeps its channel
+// and only the carriers restart, the modulator envelopes carry on
+uint8_t ymvoice_play(uint8_t lane, uint8_t note) {
+  uint8_t ch = laneVoice[lane];
+  uint8_t retrig = 0xF;
+
+  if (legatoOps && ch != 0xFF && ym_voices[ch].lane == lane && ym_key_state(ch)) {
+    retrig = legatoOps;
+  } else {
+    ch = pick_voice();
+  }
+  ym_voice_t *v = &ym_voices[ch];
+
+  v->target = note * YM_PITCH_FINE;
+  v->pitch = (glideRate && laneLast[lane]) ? laneLast[lane] : v->target;
+  v->vibPos = 0;
+  v->macroBend = 0;
+  macro_start(&v->arp, MACRO_ARP, arpMacro);
+  macro_start(&v->pitchMacro, MACRO_PITCH, pitchMacro);
+  v->arpOffset = macro_next(&v->arp); // the first frame of the macros goes out with the key on
+  v->macroBend = macro_next(&v->pitchMacro);
+  laneLast[lane] = v->target;
+  laneVoice[lane] = ch;
+
+  ym_set_fnum(ch, voice_regs(v));
+  ym_key_queue(ch, 0xF, retrig); // restarts the envelope if we stole a held note
+
+  v->lane = lane;
+  v->note = note;
+  v->held = 1;
+  v->age = ++voiceClock;
+  return ch;
+}
+
+void ymvoice_set_legato(uint8_t enable, uint8_t algo) {
+  legatoOps = enable ? ym_carrier_mask[algo & 7] : 0;
+}
+
+void ymvoice_set_pitch_mod(uint8_t glide, uint8_t vibSpeed, uint8_t depth, int8_t bend) {
+  glideRate = glide;
+  vibRate = vibSpeed;
+  vibDepth = depth;
+  pitchBend = bend;
+}
+
+void ymvoice_set_macros(uint8_t arp, uint8_t pitch) {
+  arpMacro = arp;
+  pitchMacro = pitch;
+}
+
+void ymvoice_tick() {
+  uint16_t busTaken = 0;
+
+  for (uint8_t ch = 0; ch < YM_VOICE_COUNT; ch++) {
+    ym_voice_t *v = &ym_voices[ch];
+
+    if (!ymvoice_uses(ch) || !v->note) continue;
+
+    if (v->pitch != v->target) {
+      int16_t step = glideRate << 2;
+      int16_t diff = v->target - v->pitch;
+
+      if (!step || (diff <= step && diff >= -step)) {
+        v->pitch = v->target;
+      } else {
+        v->pitch += diff > 0 ? step : -step;
+      }
+    }
+    v->vibPos += vibRate;
+    if (v->held) { // released notes keep the pitch their tail started with
+      v->arpOffset = macro_next(&v->arp);
+      v->macroBend += macro_next(&v->pitchMacro);
+      if (v->macroBend > YM_MACRO_BEND_MAX) v->macroBend = YM_MACRO_BEND_MAX;
+      if (v->macroBend < -YM_MACRO_BEND_MAX) v->macroBend = -YM_MACRO_BEND_MAX;
+    }
+
+    uint16_t regs = voice_regs(v);
+    if (regs == ym_get_fnum(ch)) continue; // nothing moved, no bus time
+
+    if (!busTaken) {
+      Z80_requestBus(1);
+      busTaken = 1;
+    }
+    ym_set_fnum(ch, regs);
+  }
+
+  if (busTaken) {
+    YM2612_latchDacDataReg();
+    Z80_releaseBus();
+  }
+}
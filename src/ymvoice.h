@@ -0,0 +1,50 @@
+#ifndef H_YMVOICE
+#define H_YMVOICE
+
+#include <stdint.h>
+#include "macro.h"
+#include "ym2612.h"
+
+#define YM_CHORD_MAX 3 // notes a single ym sequencer step can hold
+#define YM_VOICES_ALL 0x1F // channel mask of every fm channel except the dac
+#define YM_VOICES_NO_CH3 0x1B // channel 3 taken by the special mode track
+
+#define YM_GLIDE_MAX 31
+#define YM_VIB_SPEED_MAX 31
+#define YM_VIB_DEPTH_MAX 15
+#define YM_BEND_RANGE 64 // two semitones either way
+// the pitch macro sum saturates at the span of the pitch table, anything
+// further is clamped by ym_pitch_regs anyway
+#define YM_MACRO_BEND_MAX (YM_PITCH_MAX - YM_PITCH_MIN)
+
+typedef struct {
+  uint8_t note;  // midi note last played on this channel, 0 if never used
+  uint8_t held;  // 1 while the key is down
+  uint16_t age;  // allocation stamp of the last key on or key off
+  int16_t pitch;  // current fine pitch while gliding, see YM_PITCH_FINE
+  int16_t target; // fine pitch of the note
+  uint8_t vibPos; // vibrato phase
+  uint8_t lane;   // chord lane that last played on this channel
+  int16_t macroBend; // sum of the pitch macro so far, in fine steps
+  int8_t arpOffset;  // semitones from the arp macro this frame
+  macro_t arp;
+  macro_t pitchMacro;
+} ym_voice_t;
+
+extern ym_voice_t ym_voices[];
+
+// all of these expect the caller to already hold the z80 bus. key changes are
+// queued, ym_key_flush sends them
+void ymvoice_init(uint8_t chanMask);
+uint8_t ymvoice_uses(uint8_t ch);
+void ymvoice_release_all();
+uint8_t ymvoice_play(uint8_t lane, uint8_t note);
+
+void ymvoice_set_legato(uint8_t enable, uint8_t algo);
+void ymvoice_set_pitch_mod(uint8_t glide, uint8_t vibSpeed, uint8_t vibDepth, int8_t bend);
+// macro bank entries started on every new note, 0 for none
+void ymvoice_set_macros(uint8_t arp, uint8_t pitch);
+// once per frame, takes the z80 bus itself and only when a pitch has to change
+void ymvoice_tick();
+
+#endif
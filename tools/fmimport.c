@@ -0,0 +1,191 @@
+/*
+ * fmimport - turn ym2612 patch files into a rom patch table
+ *
+ *   fmimport out.h patch.tfi [patch.dmp ...]
+ *
+ * reads TFI (tfm music maker) and DMP (deflemask preset, version 11, fm)
+ * files and writes them out as ym_patch_t register bytes (see src/ym2612.h),
+ * so the rom only has to copy bytes to the chip. the patch name is the file
+ * name without its extension.
+ *
+ * built for the host by the Makefile, plain c99 and stdio only.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OP_COUNT 4
+#define NAME_LEN 8 // what fits after the patch field on the YM INST screen
+#define MAX_FILE 256
+
+typedef struct {
+  int mul, dt, tl, rs, ar, dr, am, d2r, sl, rr, ssg;
+} fm_op_t;
+
+typedef struct {
+  char name[NAME_LEN + 1];
+  int algo, fb, ams, fms;
+  fm_op_t op[OP_COUNT]; // in file order: op1, op3, op2, op4 like the registers
+} fm_patch_t;
+
+// both formats store detune centred on 3, the chip wants 0 and sign bit 2
+static const int dtReg[8] = {7, 6, 5, 0, 1, 2, 3, 4};
+
+// file operator for each of op1-op4 as the sequencer numbers them
+static const int fileOp[OP_COUNT] = {0, 2, 1, 3};
+
+static int read_file(const char *path, unsigned char *buf, int max) {
+  FILE *f = fopen(path, "rb");
+  int len;
+
+  if (!f) {
+    fprintf(stderr, "fmimport: can't open %s\n", path);
+    return -1;
+  }
+  len = (int)fread(buf, 1, max, f);
+  fclose(f);
+  return len;
+}
+
+// 42 bytes: algo, feedback, then per operator
+// mul, dt, tl, rs, ar, dr, d2r, rr, sl, ssg-eg
+static int parse_tfi(const unsigned char *b, int len, fm_patch_t *p) {
+  if (len != 42) return 0;
+
+  p->algo = b[0];
+  p->fb = b[1];
+  p->ams = 0; // not stored in tfi
+  p->fms = 0;
+  b += 2;
+  for (int i = 0; i < OP_COUNT; i++, b += 10) {
+    fm_op_t *o = &p->op[i];
+    o->mul = b[0];
+    o->dt = b[1];
+    o->tl = b[2];
+    o->rs = b[3];
+    o->ar = b[4];
+    o->dr = b[5];
+    o->d2r = b[6];
+    o->rr = b[7];
+    o->sl = b[8];
+    o->ssg = b[9];
+    o->am = 0;
+  }
+  return 1;
+}
+
+// version 11: version, system (2 = genesis), mode (1 = fm),
+// fms, feedback, algo, ams, then per operator
+// mul, tl, ar, dr, sl, rr, am, rs, dt, d2r, ssg-eg
+static int parse_dmp(const unsigned char *b, int len, fm_patch_t *p) {
+  if (len < 51 || b[0] != 0x0B || b[1] != 0x02 || b[2] != 0x01) return 0;
+
+  p->fms = b[3];
+  p->fb = b[4];
+  p->algo = b[5];
+  p->ams = b[6];
+  b += 7;
+  for (int i = 0; i < OP_COUNT; i++, b += 11) {
+    fm_op_t *o = &p->op[i];
+    o->mul = b[0];
+    o->tl = b[1];
+    o->ar = b[2];
+    o->dr = b[3];
+    o->sl = b[4];
+    o->rr = b[5];
+    o->am = b[6];
+    o->rs = b[7];
+    o->dt = b[8];
+    o->d2r = b[9];
+    o->ssg = b[10];
+  }
+  return 1;
+}
+
+static void patch_name(const char *path, char *name) {
+  const char *base = strrchr(path, '/');
+  int n = 0;
+
+  base = base ? base + 1 : path;
+  while (base[n] && base[n] != '.' && n < NAME_LEN) {
+    char c = tolower((unsigned char)base[n]);
+    name[n] = isalnum((unsigned char)c) ? c : '-';
+    n++;
+  }
+  name[n] = 0;
+}
+
+static void write_patch(FILE *out, const fm_patch_t *p) {
+  fprintf(out, "  { \"%s\", 0x%02X, 0x%02X, {\n", p->name,
+	  ((p->fb & 7) << 3) | (p->algo & 7), ((p->ams & 3) << 4) | (p->fms & 7));
+
+  for (int i = 0; i < OP_COUNT; i++) {
+    const fm_op_t *o = &p->op[fileOp[i]];
+    fprintf(out, "    {0x%02X, 0x%02X, 0x%02X, 0x%02X, 0x%02X, 0x%02X, 0x%02X}%s // op%d\n",
+	    (dtReg[o->dt & 7] << 4) | (o->mul & 15),
+	    o->tl & 0x7F,
+	    ((o->rs & 3) << 6) | (o->ar & 31),
+	    ((o->am & 1) << 7) | (o->dr & 31),
+	    o->d2r & 31,
+	    ((o->sl & 15) << 4) | (o->rr & 15),
+	    o->ssg & 0x0F,
+	    i < OP_COUNT - 1 ? "," : " ", i + 1);
+  }
+  fprintf(out, "  } },\n");
+}
+
+int main(int argc, char **argv) {
+  unsigned char buf[MAX_FILE];
+  FILE *out;
+
+  if (argc < 3) {
+    fprintf(stderr, "usage: fmimport out.h patch.tfi [patch.dmp ...]\n");
+    return 1;
+  }
+
+  out = fopen(argv[1], "w");
+  if (!out) {
+    fprintf(stderr, "fmimport: can't write %s\n", argv[1]);
+    return 1;
+  }
+
+  fprintf(out, "// generated by tools/fmimport, do not edit\n");
+  fprintf(out, "#ifndef H_YMPATCHES\n#define H_YMPATCHES\n\n");
+  fprintf(out, "#include \"ym2612.h\"\n\n");
+  fprintf(out, "// name, fb/algo (0xB0), ams/fms (0xB4), then per operator\n");
+  fprintf(out, "// 0x30 0x40 0x50 0x60 0x70 0x80 0x90\n");
+  fprintf(out, "#define YM_PATCH_COUNT %d\n\n", argc - 2);
+  fprintf(out, "static const ym_patch_t ym_patches[YM_PATCH_COUNT] = {\n");
+
+  for (int i = 2; i < argc; i++) {
+    fm_patch_t p;
+    const char *ext = strrchr(argv[i], '.');
+    int len = read_file(argv[i], buf, sizeof(buf));
+    int ok = 0;
+
+    if (len < 0) goto fail;
+    if (ext && (!strcmp(ext, ".tfi") || !strcmp(ext, ".TFI"))) {
+      ok = parse_tfi(buf, len, &p);
+    } else if (ext && (!strcmp(ext, ".dmp") || !strcmp(ext, ".DMP"))) {
+      ok = parse_dmp(buf, len, &p);
+    }
+    if (!ok) {
+      fprintf(stderr, "fmimport: %s is not a tfi or fm dmp (v11) patch\n", argv[i]);
+      goto fail;
+    }
+
+    patch_name(argv[i], p.name);
+    write_patch(out, &p);
+  }
+
+  fprintf(out, "};\n\n#endif\n");
+  fclose(out);
+  return 0;
+
+fail:
+  fclose(out);
+  remove(argv[1]);
+  return 1;
+}
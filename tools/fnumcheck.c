@@ -0,0 +1,112 @@
+/*
+ * fnumcheck - host check of the ym2612.c frequency write caching
+ *
+ *   fnumcheck
+ *
+ * builds src/ym2612.c with a ym_write that feeds a model of the chip
+ * frequency latches instead of the bus, then mixes channel 3 operator and
+ * normal channel pitch updates and checks that every frequency the driver
+ * thinks it set is what the model ended up with. the model is run twice:
+ * with AC-AE on their own latch and with AC-AE sharing the A4-A6 one.
+ *
+ * built for the host by the Makefile (make check). the rom headers come
+ * along, so no host headers here, only the few libc calls declared below.
+ */
+
+#define YM_HOST_CHECK
+#include "../src/ym2612.c"
+
+int printf(const char *fmt, ...);
+
+// what the rest of ym2612.c links against on the target
+uint8_t pal_mode;
+void vdp_vsync() {}
+uint16_t vdp_get_vblank() { return 1; }
+int Z80_getAndRequestBus(int wait) { (void)wait; return 1; }
+void Z80_releaseBus() {}
+
+static uint8_t sharedLatch; // 1 when AC-AE write the A4-A6 latch
+static uint8_t latchA4;
+static uint8_t latchAC;
+static uint16_t chipChan[YM_CHAN_COUNT]; // A4:A0 as applied by the chip
+static uint16_t chipOp[3]; // AC:A8 to AE:AA, ch3 op3, op1, op2
+
+void ym_write(int which, uint8_t addr, uint8_t value) {
+  uint8_t port = (which & 2) ? 3 : 0;
+
+  if (addr >= 0xA4 && addr <= 0xA6) {
+    latchA4 = value;
+    if (sharedLatch) latchAC = value;
+  } else if (addr >= 0xAC && addr <= 0xAE) {
+    latchAC = value;
+    if (sharedLatch) latchA4 = value;
+  } else if (addr >= 0xA0 && addr <= 0xA2) {
+    chipChan[port + addr - 0xA0] = (latchA4 << 8) | value;
+  } else if (addr >= 0xA8 && addr <= 0xAA && !port) {
+    chipOp[addr - 0xA8] = (latchAC << 8) | value;
+  }
+}
+
+// register pair of ch3 ops 1-3 in the model, see ym_ch3_fnum_lo
+static const uint8_t opIndex[3] = {1, 2, 0};
+
+static int run(uint8_t shared) {
+  uint16_t want[YM_CHAN_COUNT];
+  uint16_t wantOp[3];
+  uint16_t seed = 0xACE1;
+  int errors = 0;
+
+  sharedLatch = shared;
+  latchA4 = latchAC = 0;
+  for (uint8_t ch = 0; ch < YM_CHAN_COUNT; ch++) chipChan[ch] = want[ch] = 0;
+  for (uint8_t op = 0; op < 3; op++) chipOp[op] = wantOp[op] = 0;
+  YM2612_reset(1);
+
+  for (int i = 0; i < 20000; i++) {
+    // few pitches so the caches get hit as often as they get missed
+    uint16_t lfsr = seed;
+    seed = (seed >> 1) ^ (-(seed & 1u) & 0xB400u);
+    uint16_t regs = ym_pitch_regs(YM_PITCH_MIN + 32 * 12 * (lfsr & 3) +
+				  ((lfsr >> 2) & 1));
+    uint8_t target = (lfsr >> 8) % (YM_CHAN_COUNT + 4);
+
+    if (target < YM_CHAN_COUNT) {
+      ym_set_fnum(target, regs);
+      want[target] = regs;
+    } else {
+      uint8_t op = target - YM_CHAN_COUNT;
+      ym_set_op_fnum(op, regs);
+      if (op == 3) {
+	want[2] = regs;
+      } else {
+	wantOp[opIndex[op]] = regs;
+      }
+    }
+
+    for (uint8_t ch = 0; ch < YM_CHAN_COUNT; ch++) {
+      if (chipChan[ch] != want[ch] || ym_get_fnum(ch) != want[ch]) {
+	printf("fnumcheck: %s latch, step %d: ch%d chip %04x driver %04x, wanted %04x\n",
+	       shared ? "shared" : "split", i, ch + 1, chipChan[ch],
+	       ym_get_fnum(ch), want[ch]);
+	errors++;
+      }
+    }
+    for (uint8_t op = 0; op < 3; op++) {
+      if (chipOp[op] != wantOp[op]) {
+	printf("fnumcheck: %s latch, step %d: ch3 op pair %d has %04x, wanted %04x\n",
+	       shared ? "shared" : "split", i, op, chipOp[op], wantOp[op]);
+	errors++;
+      }
+    }
+    if (errors > 10) break;
+  }
+  return errors;
+}
+
+int main() {
+  int errors = run(0) + run(1);
+
+  if (errors) return 1;
+  printf("fnumcheck: ok\n");
+  return 0;
+}